@@ -0,0 +1,31 @@
+#ifndef AOT_H
+#define AOT_H
+
+#include "chip8.h"
+
+enum chip8_aot_status
+{
+    // ran the requested number of instructions
+    CHIP8_AOT_OK,
+    // pc left the translated code, interpret the next instruction
+    CHIP8_AOT_MISS,
+    // the rom overwrote its own translated code, interpret from now on
+    CHIP8_AOT_MODIFIED
+};
+
+// implemented by the translation unit emitted by tools/chip8rc.c
+
+// executes up to `cycles` instructions natively, starting at chip->pc
+// *executed is set to the number of instructions actually run
+enum chip8_aot_status chip8_aot_run(struct Chip8 *chip, unsigned int cycles, unsigned int *executed);
+
+// checks that the translated bytes in memory still match the rom that was translated
+int chip8_aot_intact(struct Chip8 const *chip);
+
+// implemented in src/aot.c
+
+// runs `cycles` instructions natively, interpreting whatever lies outside the translated code
+// sets *disabled once the rom modified its translated code, after that everything goes through chip8_run()
+void chip8_aot_execute(struct Chip8 *chip, unsigned int cycles, char *disabled);
+
+#endif // AOT_H
@@ -1,7 +1,15 @@
 #ifndef CHIP8_H
 #define CHIP8_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+
+#include "chip8_error.h"
+
+#ifdef CHIP8_PROFILE
+#include "profiler.h"
+#endif
 
 // initialised in src/chip8.c
 extern const unsigned int START_ADDRESS;
@@ -12,11 +20,33 @@ extern const uint8_t VIDEO_WIDTH;
 extern const uint8_t VIDEO_HEIGHT;
 extern const uint8_t CHIP8_KEYMAP[16];
 
+// memory after START_ADDRESS, less the two bytes of the end marker
+#define CHIP8_MAX_ROM_SIZE (4096 - 0x200 - 2)
+
 struct Chip8;
 typedef void (*chip8_ins)(struct Chip8 *);
+// superinstruction, returns how many instructions it executed or 0 when the code at pc doesnt match
+typedef unsigned int (*chip8_fused)(struct Chip8 *, unsigned int budget);
+
+// idioms executed as one handler by chip8_run()
+enum chip8_fusion
+{
+    // 3xkk/4xkk followed by 1nnn
+    CHIP8_FUSE_BRANCH,
+    // Annn followed by Dxyn
+    CHIP8_FUSE_SPRITE,
+    // two or more 6xkk in a row
+    CHIP8_FUSE_LOAD_RUN,
+    // Fx29 followed by Dxyn
+    CHIP8_FUSE_DIGIT,
+    // Fx33 followed by Fx65
+    CHIP8_FUSE_BCD,
+    CHIP8_FUSION_COUNT
+};
 
 struct Chip8
 {
+    // machine state, everything up to `table` is copied by chip8_copy_state()
     uint8_t registers[16];
     uint8_t memory[4096];
     uint16_t index;
@@ -27,18 +57,61 @@ struct Chip8
     uint8_t sound_timer;
     uint8_t keypad[16];
     uint32_t video[64 * 32];
+    // the same pixels one bit each, column 0 in bit 63, kept in step with `video` by OP_Dxyn and OP_00E0
+    uint64_t video_rows[32];
+    // xor of chip8_row_hash() over all rows, updated per changed row
+    uint64_t video_digest;
     uint16_t opcode;
+    // state of the per-instance generator behind Cxkk
+    uint32_t rng;
 
+    // dispatch tables, the same in every initialised chip
     chip8_ins table[0xF + 1];
-    chip8_ins table0[0xE + 1];
-    chip8_ins table8[0xE + 1];
-    chip8_ins tableE[0xE + 1];
+    chip8_ins table0[0xF + 1];
+    chip8_ins table8[0xF + 1];
+    chip8_ins tableE[0xF + 1];
     chip8_ins tableF[0x65 + 1];
+    // superinstructions by prefix of their first opcode, NULL where nothing fuses
+    chip8_fused fused[0xF + 1];
+    // bit n set when a superinstruction starting with this prefix can continue with prefix n,
+    // checked before calling into `fused` so code that doesnt fuse pays only for two loads
+    uint16_t fuse_next[0xF + 1];
+
+    // how often each superinstruction ran all of its instructions and how many instructions they covered,
+    // a skip or a write over the second instruction ends it early and counts as partial instead
+    uint64_t fusion_counts[CHIP8_FUSION_COUNT];
+    uint64_t fusion_partial[CHIP8_FUSION_COUNT];
+    uint64_t fused_instructions;
+
+#ifdef CHIP8_PROFILE
+    // not part of the machine state, chip8_copy_state() leaves it alone
+    struct Chip8Profile profile;
+#endif
 };
 
+// everything below only touches the given chip, so separate chips can run on separate threads
 void chip8_init(struct Chip8 *chip);
-void chip8_load_rom(struct Chip8 *chip, const char *filename);
+void chip8_seed(struct Chip8 *chip, uint32_t seed);
+// return CHIP8_OK or one of enum chip8_error
+int chip8_load_rom(struct Chip8 *chip, const char *filename);
+int chip8_load_rom_data(struct Chip8 *chip, uint8_t const *data, size_t size);
 void chip8_cycle(struct Chip8 *chip);
+// the opcode at address, masked into memory like the fetch in chip8_cycle() since Bnnn can push pc past it
+uint16_t chip8_fetch(struct Chip8 const *chip, unsigned int address);
+// runs `cycles` instructions like chip8_cycle() would, fusing common idioms into one dispatch
+void chip8_run(struct Chip8 *chip, unsigned int cycles);
+
+const char *chip8_fusion_name(int fusion);
+// one line per superinstruction with how often it ran in full and how often it stopped after the first instruction
+void chip8_fusion_report(struct Chip8 const *chip, FILE *out);
+
+// identifies the current frame without reading `video`: equal frames have equal digests
+uint64_t chip8_frame_digest(struct Chip8 const *chip);
+// contribution of one row of pixels to the frame digest
+uint64_t chip8_row_hash(uint64_t bits, unsigned int row);
+
+// snapshot/restore between two initialised chips, skips the dispatch tables
+void chip8_copy_state(struct Chip8 *dst, struct Chip8 const *src);
 
 void OP_NULL(struct Chip8 *chip);
 void OP_00E0(struct Chip8 *chip);
@@ -81,4 +154,11 @@ void opcode_prefix8(struct Chip8 *chip);
 void opcode_prefixE(struct Chip8 *chip);
 void opcode_prefixF(struct Chip8 *chip);
 
+unsigned int OP_FUSED_branch(struct Chip8 *chip, unsigned int budget);
+unsigned int OP_FUSED_Annn_Dxyn(struct Chip8 *chip, unsigned int budget);
+unsigned int OP_FUSED_6xkk_run(struct Chip8 *chip, unsigned int budget);
+unsigned int OP_FUSED_Fx29_Dxyn(struct Chip8 *chip, unsigned int budget);
+unsigned int OP_FUSED_Fx33_Fx65(struct Chip8 *chip, unsigned int budget);
+unsigned int fused_prefixF(struct Chip8 *chip, unsigned int budget);
+
 #endif /*CHIP8_H*/
@@ -0,0 +1,18 @@
+#ifndef CHIP8_ERROR_H
+#define CHIP8_ERROR_H
+
+// shared by the core (include/chip8.h) and the library api (include/libchip8.h)
+enum chip8_error
+{
+    CHIP8_OK = 0,
+    CHIP8_ERR_FILE,
+    CHIP8_ERR_ROM_TOO_LARGE,
+    CHIP8_ERR_NO_MEMORY,
+    CHIP8_ERR_NO_ROM,
+    CHIP8_ERR_SHARED_MEMORY
+};
+
+// initialised in src/chip8.c
+const char *chip8_error_string(int error);
+
+#endif // CHIP8_ERROR_H
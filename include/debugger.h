@@ -0,0 +1,107 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "chip8.h"
+
+#define DEBUGGER_MAX_WATCHPOINTS 16
+#define DEBUGGER_MAX_CONDITIONS 16
+
+// access flags of a watchpoint
+#define WATCH_READ 0x1u
+#define WATCH_WRITE 0x2u
+
+// why debugger_cycle() stopped before executing the instruction at pc
+enum debug_event
+{
+    DEBUG_NONE,
+    DEBUG_BREAKPOINT,
+    DEBUG_WATCHPOINT,
+    DEBUG_CONDITION,
+    DEBUG_STEP
+};
+
+enum condition_op
+{
+    COND_EQ,
+    COND_NE,
+    COND_LT,
+    COND_GT,
+    COND_LE,
+    COND_GE
+};
+
+struct Watchpoint
+{
+    uint16_t start;
+    uint16_t length;
+    uint8_t access;
+};
+
+// break when Vx <op> value, optionally only at one address
+struct Condition
+{
+    int address; // -1 for any address
+    uint8_t reg;
+    enum condition_op op;
+    uint8_t value;
+};
+
+struct Debugger
+{
+    // one bit per memory address
+    uint64_t breakpoints[4096 / 64];
+    unsigned int breakpoint_count;
+
+    struct Watchpoint watchpoints[DEBUGGER_MAX_WATCHPOINTS];
+    unsigned int watchpoint_count;
+
+    struct Condition conditions[DEBUGGER_MAX_CONDITIONS];
+    unsigned int condition_count;
+    // result of each condition before the previous instruction, they only stop on false -> true
+    char condition_held[DEBUGGER_MAX_CONDITIONS];
+
+    // stop before the next instruction
+    char break_next;
+    // step over: stop once the call returns to this address with the same stack depth
+    int return_address; // -1 when not stepping over
+    uint8_t return_sp;
+    // run the current instruction without checking, used to resume from a stop
+    char skip_check;
+    // print every executed instruction
+    char trace;
+
+    // set when anything above needs the checked path, see debugger_update()
+    char active;
+};
+
+void debugger_init(struct Debugger *dbg);
+// recomputes dbg->active, call after changing breakpoints or stepping state
+void debugger_update(struct Debugger *dbg);
+
+void debugger_set_breakpoint(struct Debugger *dbg, uint16_t address);
+void debugger_clear_breakpoint(struct Debugger *dbg, uint16_t address);
+int debugger_has_breakpoint(struct Debugger const *dbg, uint16_t address);
+
+// return 0 when the table is full
+int debugger_add_watchpoint(struct Debugger *dbg, uint16_t start, uint16_t length, uint8_t access);
+int debugger_add_condition(struct Debugger *dbg, struct Condition condition);
+
+void debugger_step(struct Debugger *dbg);
+void debugger_step_over(struct Debugger *dbg, struct Chip8 const *chip);
+void debugger_continue(struct Debugger *dbg);
+
+// checked replacement for chip8_cycle(), only used while dbg->active is set
+// returns DEBUG_NONE after executing one instruction, or the reason it stopped without executing it
+enum debug_event debugger_cycle(struct Debugger *dbg, struct Chip8 *chip);
+
+// writes the mnemonic of opcode into buffer
+void chip8_disassemble(uint16_t opcode, char *buffer, size_t size);
+
+// reads commands from `in` until execution resumes, returns 1 when the user asked to quit
+char debugger_prompt(struct Debugger *dbg, struct Chip8 *chip, enum debug_event event, FILE *in);
+
+#endif // DEBUGGER_H
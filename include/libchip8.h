@@ -0,0 +1,52 @@
+#ifndef LIBCHIP8_H
+#define LIBCHIP8_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "chip8_error.h"
+
+// embeddable api around the core, built as bin/libchip8.a and bin/libchip8.so
+// an instance holds all of its state, so any number of them can run on separate threads;
+// a single instance must not be used from two threads at once
+
+// instructions run by chip8_run_frame() unless changed
+#define CHIP8_CYCLES_PER_FRAME 10
+
+struct Chip8Instance;
+
+// returns NULL when out of memory
+struct Chip8Instance *chip8_create(void);
+void chip8_destroy(struct Chip8Instance *instance);
+
+// seeds the generator behind Cxkk, instances start with the same seed
+void chip8_set_seed(struct Chip8Instance *instance, uint32_t seed);
+void chip8_set_cycles_per_frame(struct Chip8Instance *instance, unsigned int cycles);
+
+// resets the machine and loads the rom at 0x200, returns CHIP8_OK or one of enum chip8_error
+int chip8_load_rom_from_memory(struct Chip8Instance *instance, uint8_t const *data, size_t size);
+
+// return CHIP8_ERR_NO_ROM until a rom has been loaded
+int chip8_run_cycles(struct Chip8Instance *instance, unsigned int cycles);
+int chip8_run_frame(struct Chip8Instance *instance);
+
+// 64x32 pixels, 0xFFFFFFFF when lit and 0 otherwise, valid until the instance is destroyed
+uint32_t const *chip8_get_framebuffer(struct Chip8Instance const *instance, unsigned int *width,
+                                      unsigned int *height);
+
+// 64-bit digest of the current frame, kept up to date by the draw instructions so reading it is O(1):
+// equal frames have equal digests, so comparing two is enough to detect a change or match a golden frame
+uint64_t chip8_get_frame_digest(struct Chip8Instance const *instance);
+// the frame as 32 rows of 64 bits, column 0 in bit 63, valid until the instance is destroyed
+uint64_t const *chip8_get_frame_rows(struct Chip8Instance const *instance);
+
+// how often each superinstruction ran since the rom was loaded, one `name full partial` line each: the name padded
+// to 16 columns (it may contain spaces), how often both instructions ran, then how often it stopped after the first
+// followed by the word `partial`. a last `instructions count` line gives how many instructions they covered
+void chip8_write_fusion_report(struct Chip8Instance const *instance, FILE *out);
+
+// bit n set when key n is held down
+void chip8_set_keys(struct Chip8Instance *instance, uint16_t keys);
+
+#endif // LIBCHIP8_H
@@ -0,0 +1,75 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+// log-linear buckets in the style of HdrHistogram: 16 sub-buckets per power of two, ~6% relative precision
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_BUCKETS (64 << HISTOGRAM_SUB_BITS)
+
+// recent frame times shown by the overlay
+#define METRICS_BARS 64
+
+struct Histogram
+{
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+};
+
+// host loop telemetry, all times in nanoseconds
+// owned by the thread that runs the loop, so recording needs no locks;
+// loops on other threads keep their own and combine them with metrics_merge()
+struct Metrics
+{
+    uint64_t start;
+
+    uint64_t instructions;
+    uint64_t frames_presented;
+    // 60 Hz slots that passed without a present
+    uint64_t frames_skipped;
+
+    struct Histogram frame_time;
+    struct Histogram present_time;
+    struct Histogram input_latency;
+    // snapshot and emulation of the frames presented ahead, only recorded with --run-ahead
+    struct Histogram run_ahead_time;
+
+    uint64_t last_present;
+    // time of the first keypad change not presented yet, 0 when none
+    uint64_t pending_input;
+
+    // rates are computed between exports
+    uint64_t last_export;
+    uint64_t last_export_instructions;
+    uint64_t last_export_frames;
+    double instructions_per_second;
+    double frames_per_second;
+
+    // frame times, oldest first, 128 is one 60 Hz frame
+    uint8_t bars[METRICS_BARS];
+};
+
+// monotonic clock
+uint64_t metrics_now(void);
+
+void metrics_init(struct Metrics *metrics, uint64_t now);
+void metrics_input(struct Metrics *metrics, uint64_t now);
+// start and end of update_window()
+void metrics_present(struct Metrics *metrics, uint64_t start, uint64_t end);
+void metrics_merge(struct Metrics *into, struct Metrics const *from);
+
+// updates the rates and writes every metric as "name value" lines, replacing the file
+// returns CHIP8_OK or CHIP8_ERR_FILE
+int metrics_export(struct Metrics *metrics, const char *filename, uint64_t now);
+// one line summary for the window title
+void metrics_summary(struct Metrics const *metrics, char *buffer, int size);
+
+void histogram_record(struct Histogram *histogram, uint64_t value);
+// upper bound of the bucket holding the given quantile (0..1)
+uint64_t histogram_quantile(struct Histogram const *histogram, double quantile);
+void histogram_merge(struct Histogram *into, struct Histogram const *from);
+
+#endif // METRICS_H
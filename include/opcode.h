@@ -0,0 +1,72 @@
+#ifndef OPCODE_H
+#define OPCODE_H
+
+#include <stdint.h>
+
+// the one opcode decoder: chip8_init() builds the dispatch tables from it, and the
+// disassembler, profiler and tools/chip8rc.c classify instructions with it
+
+// every handler the dispatch tables can run
+enum chip8_op
+{
+    CHIP8_OP_NULL,
+    CHIP8_OP_00E0,
+    CHIP8_OP_00EE,
+    CHIP8_OP_1nnn,
+    CHIP8_OP_2nnn,
+    CHIP8_OP_3xkk,
+    CHIP8_OP_4xkk,
+    CHIP8_OP_5xy0,
+    CHIP8_OP_6xkk,
+    CHIP8_OP_7xkk,
+    CHIP8_OP_8xy0,
+    CHIP8_OP_8xy1,
+    CHIP8_OP_8xy2,
+    CHIP8_OP_8xy3,
+    CHIP8_OP_8xy4,
+    CHIP8_OP_8xy5,
+    CHIP8_OP_8xy6,
+    CHIP8_OP_8xy7,
+    CHIP8_OP_8xyE,
+    CHIP8_OP_9xy0,
+    CHIP8_OP_Annn,
+    CHIP8_OP_Bnnn,
+    CHIP8_OP_Cxkk,
+    CHIP8_OP_Dxyn,
+    CHIP8_OP_Ex9E,
+    CHIP8_OP_ExA1,
+    CHIP8_OP_Fx07,
+    CHIP8_OP_Fx0A,
+    CHIP8_OP_Fx15,
+    CHIP8_OP_Fx18,
+    CHIP8_OP_Fx1E,
+    CHIP8_OP_Fx29,
+    CHIP8_OP_Fx33,
+    CHIP8_OP_Fx55,
+    CHIP8_OP_Fx65,
+    CHIP8_OP_COUNT
+};
+
+// what an instruction does besides falling through to the next one
+#define CHIP8_OPF_JUMP 0x01u
+#define CHIP8_OPF_CALL 0x02u
+#define CHIP8_OPF_RETURN 0x04u
+// jump whose target is only known at runtime
+#define CHIP8_OPF_INDIRECT 0x08u
+#define CHIP8_OPF_SKIP 0x10u
+// Fx0A, repeats itself until a key is pressed
+#define CHIP8_OPF_WAIT 0x20u
+// reads or writes memory starting at I
+#define CHIP8_OPF_READ 0x40u
+#define CHIP8_OPF_WRITE 0x80u
+
+// anything that ends a basic block
+#define CHIP8_OPF_BRANCH                                                                                       \
+    (CHIP8_OPF_JUMP | CHIP8_OPF_CALL | CHIP8_OPF_RETURN | CHIP8_OPF_INDIRECT | CHIP8_OPF_SKIP | CHIP8_OPF_WAIT)
+
+enum chip8_op chip8_decode(uint16_t opcode);
+// handler name without the OP_ prefix, e.g. "8xy4"
+const char *chip8_op_name(enum chip8_op op);
+unsigned int chip8_op_flags(enum chip8_op op);
+
+#endif // OPCODE_H
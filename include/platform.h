@@ -3,20 +3,26 @@
 
 #include <SDL2/SDL.h>
 
-// initialized in src/chip8.c
-extern uint8_t KEYPAD_MAP[128];
-
 struct Platform
 {
     SDL_Window *window;
     SDL_Renderer *renderer;
     SDL_Texture *texture;
+
+    // keyboard key to chip8 key, 255 when unmapped
+    uint8_t keypad_map[128];
+
+    // bars drawn over the frame when set, 128 is a quarter of the window height
+    uint8_t const *overlay;
+    int overlay_count;
 };
 
 void platform_init(struct Platform *platform, char const *title, int window_width, int window_height, int texture_width,
                    int texture_height);
 
 void update_window(struct Platform *platform, void const *buffer, int pitch);
+void platform_set_overlay(struct Platform *platform, uint8_t const *bars, int count);
+void platform_set_title(struct Platform *platform, char const *title);
 char process_input(struct Platform *platform, uint8_t *keys);
 
 void platform_destroy(struct Platform *platform);
@@ -0,0 +1,49 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+// guest profiler, compiled in with -DCHIP8_PROFILE (make PROFILE=1)
+// the counters are plain arrays inside struct Chip8, filled by chip8_cycle()
+
+#define PROFILE_MAX_NODES 4096
+// no node, the root node is 0
+#define PROFILE_NO_NODE 0xFFFFu
+
+// one per call path, children are chained through next_sibling
+struct ProfileNode
+{
+    uint16_t function;
+    uint16_t parent;
+    uint16_t first_child;
+    uint16_t next_sibling;
+    // instructions executed while this node was on top
+    uint64_t self;
+    uint64_t calls;
+};
+
+struct Chip8Profile
+{
+    // indexed by opcode >> 12, then the low byte
+    uint64_t op_counts[16][256];
+    uint64_t pc_counts[4096];
+
+    // call tree built from 2nnn/00EE, node 0 is the entry point
+    struct ProfileNode nodes[PROFILE_MAX_NODES];
+    uint16_t node_count;
+    uint16_t current;
+    // calls that didnt get a node because the tree was full, and how many of them are still open
+    uint64_t lost_calls;
+    uint16_t lost_depth;
+};
+
+struct Chip8;
+
+void chip8_profile_reset(struct Chip8Profile *profile, uint16_t entry);
+// opcode counts by class, hot spots, hot blocks, loops and the call tree
+// return CHIP8_OK, CHIP8_ERR_NO_MEMORY or CHIP8_ERR_FILE
+int chip8_profile_write_report(struct Chip8 const *chip, const char *filename);
+// one line per call path with its exclusive instruction count, for flamegraph.pl
+int chip8_profile_write_folded(struct Chip8 const *chip, const char *filename);
+
+#endif // PROFILER_H
@@ -0,0 +1,52 @@
+#ifndef SHM_EXPORT_H
+#define SHM_EXPORT_H
+
+#include <stdint.h>
+
+#include "chip8.h"
+
+#define CHIP8_SHM_MAGIC 0x43384D53u // "C8MS"
+#define CHIP8_SHM_VERSION 2u
+
+// layout of the posix shared memory segment, guarded by a seqlock:
+// the writer makes `sequence` odd, copies the frame, then makes it even again.
+// readers copy what they need and retry when `sequence` was odd or changed meanwhile
+struct Chip8SharedFrame
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sequence;
+    uint32_t width;
+    uint32_t height;
+    // frames published so far
+    uint64_t frame;
+
+    uint8_t registers[16];
+    uint16_t index;
+    uint16_t pc;
+    uint8_t sp;
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+
+    // chip8_frame_digest() of `video`, unchanged when the frame is a duplicate of the previous one
+    uint64_t digest;
+    uint32_t video[64 * 32];
+};
+
+struct ShmExport
+{
+    struct Chip8SharedFrame *frame;
+    char name[64];
+};
+
+// creates and maps the segment, name starts with '/', returns CHIP8_OK or CHIP8_ERR_SHARED_MEMORY
+int shm_export_open(struct ShmExport *shm, const char *name);
+// a memcpy of the frame, no syscalls
+void shm_export_publish(struct ShmExport *shm, struct Chip8 const *chip);
+// unmaps and removes the segment
+void shm_export_close(struct ShmExport *shm);
+
+// reader side of the seqlock, copies a consistent frame into `out`
+void shm_export_read(struct Chip8SharedFrame const *frame, struct Chip8SharedFrame *out);
+
+#endif // SHM_EXPORT_H
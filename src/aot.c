@@ -0,0 +1,39 @@
+#include <stdint.h>
+
+#include "chip8.h"
+#include "opcode.h"
+
+#ifdef CHIP8_AOT
+
+#include "aot.h"
+
+void chip8_aot_execute(struct Chip8 *chip, unsigned int cycles, char *disabled)
+{
+    while (cycles > 0 && !*disabled)
+    {
+        unsigned int executed = 0;
+        if (chip8_aot_run(chip, cycles, &executed) == CHIP8_AOT_MODIFIED)
+        {
+            *disabled = 1;
+        }
+        // never more than asked for, an overcount would wrap the budget around
+        cycles -= executed < cycles ? executed : cycles;
+
+        if (executed == 0)
+        {
+            uint16_t opcode = chip8_fetch(chip, chip->pc);
+            chip8_cycle(chip);
+            cycles--;
+
+            // only Fx33 and Fx55 write memory, same as the checks in the translated code
+            if ((chip8_op_flags(chip8_decode(opcode)) & CHIP8_OPF_WRITE) && !chip8_aot_intact(chip))
+            {
+                *disabled = 1;
+            }
+        }
+    }
+
+    chip8_run(chip, cycles);
+}
+
+#endif
@@ -1,11 +1,12 @@
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
 #include "chip8.h"
 #include "fonts.h"
+#include "opcode.h"
 
 const unsigned int START_ADDRESS = 0x200;
 const unsigned int FONTSET_START_ADDRESS = 0x50;
@@ -16,8 +17,18 @@ const uint8_t VIDEO_HEIGHT = 32;
 // extern'ed in include/chip8.h
 const uint8_t CHIP8_KEYMAP[16] = {'x', '1', '2', '3', 'q', 'w', 'e', 'a', 's', 'd', 'z', 'c', '4', 'r', 'f', 'v'};
 
-// extern'ed in src/platform.c
-uint8_t KEYPAD_MAP[128];
+// handler for each result of chip8_decode()
+static const chip8_ins handlers[CHIP8_OP_COUNT] = {
+    [CHIP8_OP_NULL] = &OP_NULL, [CHIP8_OP_00E0] = &OP_00E0, [CHIP8_OP_00EE] = &OP_00EE, [CHIP8_OP_1nnn] = &OP_1nnn,
+    [CHIP8_OP_2nnn] = &OP_2nnn, [CHIP8_OP_3xkk] = &OP_3xkk, [CHIP8_OP_4xkk] = &OP_4xkk, [CHIP8_OP_5xy0] = &OP_5xy0,
+    [CHIP8_OP_6xkk] = &OP_6xkk, [CHIP8_OP_7xkk] = &OP_7xkk, [CHIP8_OP_8xy0] = &OP_8xy0, [CHIP8_OP_8xy1] = &OP_8xy1,
+    [CHIP8_OP_8xy2] = &OP_8xy2, [CHIP8_OP_8xy3] = &OP_8xy3, [CHIP8_OP_8xy4] = &OP_8xy4, [CHIP8_OP_8xy5] = &OP_8xy5,
+    [CHIP8_OP_8xy6] = &OP_8xy6, [CHIP8_OP_8xy7] = &OP_8xy7, [CHIP8_OP_8xyE] = &OP_8xyE, [CHIP8_OP_9xy0] = &OP_9xy0,
+    [CHIP8_OP_Annn] = &OP_Annn, [CHIP8_OP_Bnnn] = &OP_Bnnn, [CHIP8_OP_Cxkk] = &OP_Cxkk, [CHIP8_OP_Dxyn] = &OP_Dxyn,
+    [CHIP8_OP_Ex9E] = &OP_Ex9E, [CHIP8_OP_ExA1] = &OP_ExA1, [CHIP8_OP_Fx07] = &OP_Fx07, [CHIP8_OP_Fx0A] = &OP_Fx0A,
+    [CHIP8_OP_Fx15] = &OP_Fx15, [CHIP8_OP_Fx18] = &OP_Fx18, [CHIP8_OP_Fx1E] = &OP_Fx1E, [CHIP8_OP_Fx29] = &OP_Fx29,
+    [CHIP8_OP_Fx33] = &OP_Fx33, [CHIP8_OP_Fx55] = &OP_Fx55, [CHIP8_OP_Fx65] = &OP_Fx65,
+};
 
 void chip8_init(struct Chip8 *chip)
 {
@@ -30,7 +41,9 @@ void chip8_init(struct Chip8 *chip)
     chip->delay_timer = 0;
     chip->sound_timer = 0;
     memset(&chip->keypad, 0, sizeof(chip->keypad));
-    memset(&chip->video, 0, sizeof(chip->video));
+    // clears video and resets its digest
+    OP_00E0(chip);
+    chip8_seed(chip, 1);
 
     // loading fonts into memory
     for (unsigned int i = 0; i < FONTSET_SIZE; i++)
@@ -38,10 +51,6 @@ void chip8_init(struct Chip8 *chip)
         chip->memory[FONTSET_START_ADDRESS + i] = fontset[i];
     }
 
-    // setting seed for rand()
-    // !use %255 to contain it into a byte
-    srand(time(NULL));
-
     // function pointer tables
     chip->table[0x0] = &opcode_prefix0;
     chip->table[0x1] = &OP_1nnn;
@@ -60,102 +69,171 @@ void chip8_init(struct Chip8 *chip)
     chip->table[0xE] = &opcode_prefixE;
     chip->table[0xF] = &opcode_prefixF;
 
-    for (uint8_t i = 0; i <= 0xE; i++)
+    // tables 0, 8, E and F: whatever chip8_decode() makes of the bits each table is indexed by
+    for (uint8_t i = 0; i <= 0xF; i++)
     {
-        chip->table0[i] = &OP_NULL;
-        chip->table8[i] = &OP_NULL;
-        chip->tableE[i] = &OP_NULL;
+        chip->table0[i] = handlers[chip8_decode(0x0000u | i)];
+        chip->table8[i] = handlers[chip8_decode(0x8000u | i)];
+        chip->tableE[i] = handlers[chip8_decode(0xE000u | i)];
     }
 
     for (uint8_t i = 0; i <= 0x65; i++)
     {
-        chip->tableF[i] = &OP_NULL;
+        chip->tableF[i] = handlers[chip8_decode(0xF000u | i)];
     }
 
-    // table 0: opcodes with prefix 0
-    chip->table0[0x0] = &OP_00E0;
-    chip->table0[0xE] = &OP_00EE;
-
-    // table 8: opcodes with prefix 8
-    chip->table8[0x0] = &OP_8xy0;
-    chip->table8[0x1] = &OP_8xy1;
-    chip->table8[0x2] = &OP_8xy2;
-    chip->table8[0x3] = &OP_8xy3;
-    chip->table8[0x4] = &OP_8xy4;
-    chip->table8[0x5] = &OP_8xy5;
-    chip->table8[0x6] = &OP_8xy6;
-    chip->table8[0x7] = &OP_8xy7;
-    chip->table8[0xE] = &OP_8xyE;
+    // superinstructions: chip8_run() tries these before the tables
+    for (uint8_t i = 0; i <= 0xF; i++)
+    {
+        chip->fused[i] = NULL;
+        chip->fuse_next[i] = 0;
+    }
+    chip->fused[0x3] = &OP_FUSED_branch;
+    chip->fused[0x4] = &OP_FUSED_branch;
+    chip->fused[0x6] = &OP_FUSED_6xkk_run;
+    chip->fused[0xA] = &OP_FUSED_Annn_Dxyn;
+    chip->fused[0xF] = &fused_prefixF;
+    chip->fuse_next[0x3] = 1u << 0x1;
+    chip->fuse_next[0x4] = 1u << 0x1;
+    chip->fuse_next[0x6] = 1u << 0x6;
+    chip->fuse_next[0xA] = 1u << 0xD;
+    chip->fuse_next[0xF] = (1u << 0xD) | (1u << 0xF);
 
-    // table E: opcodes with prefix E
-    chip->tableE[0xE] = &OP_Ex9E;
-    chip->tableE[0x1] = &OP_ExA1;
+    memset(&chip->fusion_counts, 0, sizeof(chip->fusion_counts));
+    memset(&chip->fusion_partial, 0, sizeof(chip->fusion_partial));
+    chip->fused_instructions = 0;
 
-    // table F: opcodes with prefix F
-    chip->tableF[0x07] = &OP_Fx07;
-    chip->tableF[0x0A] = &OP_Fx0A;
-    chip->tableF[0x15] = &OP_Fx15;
-    chip->tableF[0x18] = &OP_Fx18;
-    chip->tableF[0x1E] = &OP_Fx1E;
-    chip->tableF[0x29] = &OP_Fx29;
-    chip->tableF[0x33] = &OP_Fx33;
-    chip->tableF[0x55] = &OP_Fx55;
-    chip->tableF[0x65] = &OP_Fx65;
+#ifdef CHIP8_PROFILE
+    chip8_profile_reset(&chip->profile, START_ADDRESS);
+#endif
+}
 
-    // initializing map of keypad with keyboard
-    for (uint8_t i = 0; i < 128; i++)
-    {
-        KEYPAD_MAP[i] = -1;
-    }
-    for (uint8_t i = 0; i < 16; i++)
-    {
-        KEYPAD_MAP[CHIP8_KEYMAP[i]] = i;
-    }
+void chip8_seed(struct Chip8 *chip, uint32_t seed)
+{
+    // xorshift gets stuck at 0
+    chip->rng = seed ? seed : 1;
 }
 
-void chip8_load_rom(struct Chip8 *chip, char const *filename)
+int chip8_load_rom(struct Chip8 *chip, char const *filename)
 {
-    FILE *rom = fopen(filename, "r");
+    FILE *rom = fopen(filename, "rb");
 
     // if file doesnt exists
     if (rom == NULL)
     {
-        printf("file not loaded");
-        return;
+        return CHIP8_ERR_FILE;
     }
 
-    fseek(rom, 0, SEEK_END);
-    size_t rom_size = ftell(rom) - 1;
-    fseek(rom, 0, SEEK_SET);
+    // one byte more than fits, to detect roms that are too large
+    uint8_t data[CHIP8_MAX_ROM_SIZE + 1];
+    size_t rom_size = fread(data, sizeof(uint8_t), sizeof(data), rom);
+    int error = ferror(rom);
 
-    // if rom is larger than the memory
-    if (rom_size > (int)(0xfff - START_ADDRESS))
+    fclose(rom);
+
+    if (error)
     {
-        printf("memory full, couldnt load the whole file");
-        return;
+        return CHIP8_ERR_FILE;
     }
 
-    // reading from file one byte at a time into the memory of the chip
-    int i = 0;
-    while (fread(&chip->memory[START_ADDRESS + i], sizeof(uint8_t), 1, rom))
+    return chip8_load_rom_data(chip, data, rom_size);
+}
+
+int chip8_load_rom_data(struct Chip8 *chip, uint8_t const *data, size_t size)
+{
+    // if rom is larger than the memory
+    if (size > CHIP8_MAX_ROM_SIZE)
     {
-        i++;
+        return CHIP8_ERR_ROM_TOO_LARGE;
     }
-    // removing last byte of the file as it is "end of line" character
-    chip->memory[START_ADDRESS + i] = 0xFEu;
-    chip->memory[START_ADDRESS + i + 1] = 0xEFu;
 
-    fclose(rom);
+    memcpy(&chip->memory[START_ADDRESS], data, size);
+
+    // 0xFEEF after the rom keeps pc from running past its end
+    chip->memory[START_ADDRESS + size] = 0xFEu;
+    chip->memory[START_ADDRESS + size + 1] = 0xEFu;
 
-    fflush(stdout);
+    return CHIP8_OK;
 }
 
-void chip8_cycle(struct Chip8 *chip)
+const char *chip8_error_string(int error)
+{
+    switch (error)
+    {
+    case CHIP8_OK:
+        return "no error";
+    case CHIP8_ERR_FILE:
+        return "file not loaded";
+    case CHIP8_ERR_ROM_TOO_LARGE:
+        return "memory full, couldnt load the whole file";
+    case CHIP8_ERR_NO_MEMORY:
+        return "out of memory";
+    case CHIP8_ERR_NO_ROM:
+        return "no rom loaded";
+    case CHIP8_ERR_SHARED_MEMORY:
+        return "couldnt create shared memory segment";
+    }
+    return "unknown error";
+}
+
+#ifdef CHIP8_PROFILE
+// counts the instruction about to run and follows calls and returns through the call tree
+static void profile_record(struct Chip8 *chip)
 {
+    struct Chip8Profile *profile = &chip->profile;
+    uint16_t opcode = chip->opcode;
+
+    profile->op_counts[opcode >> 12u][opcode & 0x00FFu]++;
+    profile->pc_counts[chip->pc & 0x0FFFu]++;
+    // the call belongs to the caller and the return to the callee
+    profile->nodes[profile->current].self++;
+
+    if ((opcode & 0xF000u) == 0x2000u)
+    {
+        uint16_t function = opcode & 0x0FFFu;
+        uint16_t child = profile->nodes[profile->current].first_child;
+
+        while (child != PROFILE_NO_NODE && profile->nodes[child].function != function)
+        {
+            child = profile->nodes[child].next_sibling;
+        }
+
+        if (child == PROFILE_NO_NODE)
+        {
+            if (profile->node_count == PROFILE_MAX_NODES)
+            {
+                profile->lost_calls++;
+                profile->lost_depth++;
+                return;
+            }
 
-    // fetch
-    chip->opcode = (chip->memory[chip->pc] << 8u) | chip->memory[chip->pc + 1];
+            child = profile->node_count++;
+            profile->nodes[child] = (struct ProfileNode){function, profile->current, PROFILE_NO_NODE,
+                                                         profile->nodes[profile->current].first_child, 0, 0};
+            profile->nodes[profile->current].first_child = child;
+        }
 
+        profile->nodes[child].calls++;
+        profile->current = child;
+    }
+    else if ((opcode & 0xF00Fu) == 0x000Eu)
+    {
+        if (profile->lost_depth > 0)
+            profile->lost_depth--;
+        else if (profile->current != 0)
+            profile->current = profile->nodes[profile->current].parent;
+    }
+}
+#endif
+
+uint16_t chip8_fetch(struct Chip8 const *chip, unsigned int address)
+{
+    return (chip->memory[address & 0x0FFFu] << 8u) | chip->memory[(address + 1) & 0x0FFFu];
+}
+
+// everything after the fetch: runs chip->opcode and ticks the timers
+static void execute(struct Chip8 *chip)
+{
     // move pc to next instruction
     chip->pc += 2;
 
@@ -163,7 +241,6 @@ void chip8_cycle(struct Chip8 *chip)
     {
         chip->pc -= 2;
     }
-    printf("current instruction: %x\n", chip->opcode);
     // execute
     (*chip->table[(chip->opcode & 0xF000u) >> 12u])(chip);
 
@@ -176,6 +253,95 @@ void chip8_cycle(struct Chip8 *chip)
         chip->sound_timer--;
 }
 
+void chip8_cycle(struct Chip8 *chip)
+{
+
+    // fetch, pc can be pushed past memory by Bnnn
+    chip->opcode = chip8_fetch(chip, chip->pc);
+
+#ifdef CHIP8_PROFILE
+    profile_record(chip);
+#endif
+
+    execute(chip);
+}
+
+void chip8_run(struct Chip8 *chip, unsigned int cycles)
+{
+#ifdef CHIP8_PROFILE
+    // the profile needs to see every instruction on its own
+    for (unsigned int i = 0; i < cycles; i++)
+    {
+        chip8_cycle(chip);
+    }
+#else
+    unsigned int executed = 0;
+
+    while (executed < cycles)
+    {
+        chip->opcode = chip8_fetch(chip, chip->pc);
+
+        // only the prefix of the next opcode is looked at before committing to a superinstruction
+        uint16_t next = chip->fuse_next[chip->opcode >> 12u];
+        if (next && cycles - executed >= 2 && ((next >> (chip->memory[(chip->pc + 2) & 0x0FFFu] >> 4u)) & 1u))
+        {
+            unsigned int ran = (*chip->fused[chip->opcode >> 12u])(chip, cycles - executed);
+            if (ran)
+            {
+                // none of the fused instructions read the timers, so ticking them afterwards is the same
+                chip->delay_timer = chip->delay_timer > ran ? chip->delay_timer - ran : 0;
+                chip->sound_timer = chip->sound_timer > ran ? chip->sound_timer - ran : 0;
+
+                chip->fused_instructions += ran;
+                executed += ran;
+                continue;
+            }
+        }
+
+        execute(chip);
+        executed++;
+    }
+#endif
+}
+
+const char *chip8_fusion_name(int fusion)
+{
+    switch (fusion)
+    {
+    case CHIP8_FUSE_BRANCH:
+        return "3xkk/4xkk+1nnn";
+    case CHIP8_FUSE_SPRITE:
+        return "Annn+Dxyn";
+    case CHIP8_FUSE_LOAD_RUN:
+        return "6xkk run";
+    case CHIP8_FUSE_DIGIT:
+        return "Fx29+Dxyn";
+    case CHIP8_FUSE_BCD:
+        return "Fx33+Fx65";
+    }
+    return "unknown";
+}
+
+void chip8_fusion_report(struct Chip8 const *chip, FILE *out)
+{
+    for (int i = 0; i < CHIP8_FUSION_COUNT; i++)
+    {
+        fprintf(out, "%-16s %-12llu %llu partial\n", chip8_fusion_name(i), (unsigned long long)chip->fusion_counts[i],
+                (unsigned long long)chip->fusion_partial[i]);
+    }
+    fprintf(out, "%-16s %llu\n", "instructions", (unsigned long long)chip->fused_instructions);
+}
+
+uint64_t chip8_frame_digest(struct Chip8 const *chip)
+{
+    return chip->video_digest;
+}
+
+void chip8_copy_state(struct Chip8 *dst, struct Chip8 const *src)
+{
+    memcpy(dst, src, offsetof(struct Chip8, table));
+}
+
 void opcode_prefix0(struct Chip8 *chip)
 {
     (*chip->table0[chip->opcode & 0x000Fu])(chip);
@@ -190,5 +356,23 @@ void opcode_prefixE(struct Chip8 *chip)
 }
 void opcode_prefixF(struct Chip8 *chip)
 {
+    // tableF stops at 0x65
+    if ((chip->opcode & 0x00FFu) > 0x65u)
+    {
+        OP_NULL(chip);
+        return;
+    }
     (*chip->tableF[chip->opcode & 0x00FFu])(chip);
 }
+
+unsigned int fused_prefixF(struct Chip8 *chip, unsigned int budget)
+{
+    switch (chip->memory[(chip->pc + 1) & 0x0FFFu])
+    {
+    case 0x29:
+        return OP_FUSED_Fx29_Dxyn(chip, budget);
+    case 0x33:
+        return OP_FUSED_Fx33_Fx65(chip, budget);
+    }
+    return 0;
+}
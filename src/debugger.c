@@ -0,0 +1,552 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "debugger.h"
+#include "opcode.h"
+
+void debugger_init(struct Debugger *dbg)
+{
+    memset(dbg, 0, sizeof(*dbg));
+    dbg->return_address = -1;
+}
+
+void debugger_update(struct Debugger *dbg)
+{
+    dbg->active = dbg->breakpoint_count > 0 || dbg->watchpoint_count > 0 || dbg->condition_count > 0 ||
+                  dbg->break_next || dbg->return_address >= 0 || dbg->trace;
+}
+
+void debugger_set_breakpoint(struct Debugger *dbg, uint16_t address)
+{
+    address &= 0x0FFFu;
+    if (!debugger_has_breakpoint(dbg, address))
+    {
+        dbg->breakpoints[address / 64] |= 1ull << (address % 64);
+        dbg->breakpoint_count++;
+    }
+    debugger_update(dbg);
+}
+
+void debugger_clear_breakpoint(struct Debugger *dbg, uint16_t address)
+{
+    address &= 0x0FFFu;
+    if (debugger_has_breakpoint(dbg, address))
+    {
+        dbg->breakpoints[address / 64] &= ~(1ull << (address % 64));
+        dbg->breakpoint_count--;
+    }
+    debugger_update(dbg);
+}
+
+int debugger_has_breakpoint(struct Debugger const *dbg, uint16_t address)
+{
+    address &= 0x0FFFu;
+    return (dbg->breakpoints[address / 64] >> (address % 64)) & 1u;
+}
+
+int debugger_add_watchpoint(struct Debugger *dbg, uint16_t start, uint16_t length, uint8_t access)
+{
+    if (dbg->watchpoint_count == DEBUGGER_MAX_WATCHPOINTS)
+        return 0;
+
+    dbg->watchpoints[dbg->watchpoint_count++] = (struct Watchpoint){start, length, access};
+    debugger_update(dbg);
+    return 1;
+}
+
+int debugger_add_condition(struct Debugger *dbg, struct Condition condition)
+{
+    if (dbg->condition_count == DEBUGGER_MAX_CONDITIONS)
+        return 0;
+
+    dbg->condition_held[dbg->condition_count] = 0;
+    dbg->conditions[dbg->condition_count++] = condition;
+    debugger_update(dbg);
+    return 1;
+}
+
+void debugger_step(struct Debugger *dbg)
+{
+    dbg->skip_check = 1;
+    dbg->break_next = 1;
+    debugger_update(dbg);
+}
+
+void debugger_step_over(struct Debugger *dbg, struct Chip8 const *chip)
+{
+    uint16_t opcode = chip8_fetch(chip, chip->pc);
+
+    // anything other than a call is a plain step
+    if ((opcode & 0xF000u) != 0x2000u)
+    {
+        debugger_step(dbg);
+        return;
+    }
+
+    dbg->skip_check = 1;
+    dbg->return_address = chip->pc + 2;
+    dbg->return_sp = chip->sp;
+    debugger_update(dbg);
+}
+
+void debugger_continue(struct Debugger *dbg)
+{
+    dbg->skip_check = 1;
+    debugger_update(dbg);
+}
+
+// memory range the instruction is about to touch, mirrors the loops in src/ins_set.c
+static uint8_t memory_access(struct Chip8 const *chip, uint16_t opcode, uint16_t *start, uint16_t *length)
+{
+    enum chip8_op op = chip8_decode(opcode);
+    unsigned int flags = chip8_op_flags(op);
+
+    *start = chip->index;
+
+    if (op == CHIP8_OP_Dxyn)
+        *length = opcode & 0x000Fu;
+    else if (op == CHIP8_OP_Fx33)
+        *length = 3;
+    else
+        *length = (opcode & 0x0F00u) >> 8u;
+
+    return (flags & CHIP8_OPF_READ ? WATCH_READ : 0) | (flags & CHIP8_OPF_WRITE ? WATCH_WRITE : 0);
+}
+
+// the handlers wrap around memory, so the accessed bytes are compared one by one
+static int overlaps(struct Watchpoint const *watch, uint16_t start, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++)
+    {
+        if (((((start + i) & 0x0FFFu) - watch->start) & 0x0FFFu) < watch->length)
+            return 1;
+    }
+    return 0;
+}
+
+static int condition_holds(struct Condition const *cond, struct Chip8 const *chip)
+{
+    uint8_t value = chip->registers[cond->reg];
+
+    if (cond->address >= 0 && cond->address != (chip->pc & 0x0FFFu))
+        return 0;
+
+    switch (cond->op)
+    {
+    case COND_EQ:
+        return value == cond->value;
+    case COND_NE:
+        return value != cond->value;
+    case COND_LT:
+        return value < cond->value;
+    case COND_GT:
+        return value > cond->value;
+    case COND_LE:
+        return value <= cond->value;
+    case COND_GE:
+        return value >= cond->value;
+    }
+    return 0;
+}
+
+// a stop inside a stepped over call ends the step over, so a later `c` doesnt stop at the old return site
+static enum debug_event stop(struct Debugger *dbg, enum debug_event event)
+{
+    if (dbg->return_address >= 0)
+    {
+        dbg->return_address = -1;
+        debugger_update(dbg);
+    }
+    return event;
+}
+
+static enum debug_event check(struct Debugger *dbg, struct Chip8 const *chip)
+{
+    if (dbg->break_next)
+    {
+        dbg->break_next = 0;
+        debugger_update(dbg);
+        return DEBUG_STEP;
+    }
+
+    if (dbg->return_address == chip->pc && dbg->return_sp == chip->sp)
+    {
+        dbg->return_address = -1;
+        debugger_update(dbg);
+        return DEBUG_STEP;
+    }
+
+    if (debugger_has_breakpoint(dbg, chip->pc))
+        return stop(dbg, DEBUG_BREAKPOINT);
+
+    // conditions stop when they become true, so `c` gets past one that stays true
+    char became_true = 0;
+    for (unsigned int i = 0; i < dbg->condition_count; i++)
+    {
+        char holds = condition_holds(&dbg->conditions[i], chip);
+        became_true |= holds && !dbg->condition_held[i];
+        dbg->condition_held[i] = holds;
+    }
+    if (became_true)
+        return stop(dbg, DEBUG_CONDITION);
+
+    if (dbg->watchpoint_count > 0)
+    {
+        uint16_t opcode = chip8_fetch(chip, chip->pc);
+        uint16_t start, length;
+        uint8_t access = memory_access(chip, opcode, &start, &length);
+
+        for (unsigned int i = 0; access && i < dbg->watchpoint_count; i++)
+        {
+            struct Watchpoint const *watch = &dbg->watchpoints[i];
+
+            if ((watch->access & access) && overlaps(watch, start, length))
+                return stop(dbg, DEBUG_WATCHPOINT);
+        }
+    }
+
+    return DEBUG_NONE;
+}
+
+enum debug_event debugger_cycle(struct Debugger *dbg, struct Chip8 *chip)
+{
+    if (dbg->skip_check)
+    {
+        dbg->skip_check = 0;
+    }
+    else
+    {
+        enum debug_event event = check(dbg, chip);
+        if (event != DEBUG_NONE)
+            return event;
+    }
+
+    if (dbg->trace)
+    {
+        char text[32];
+        uint16_t opcode = chip8_fetch(chip, chip->pc);
+
+        chip8_disassemble(opcode, text, sizeof(text));
+        printf("%03X: %04X  %s\n", chip->pc, opcode, text);
+    }
+
+    chip8_cycle(chip);
+    return DEBUG_NONE;
+}
+
+void chip8_disassemble(uint16_t opcode, char *buffer, size_t size)
+{
+    static const char *alu[] = {"LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN"};
+    unsigned int x = (opcode & 0x0F00u) >> 8u;
+    unsigned int y = (opcode & 0x00F0u) >> 4u;
+    unsigned int n = opcode & 0x000Fu;
+    unsigned int byte = opcode & 0x00FFu;
+    unsigned int address = opcode & 0x0FFFu;
+    enum chip8_op op = chip8_decode(opcode);
+
+    switch (op)
+    {
+    case CHIP8_OP_00E0:
+        snprintf(buffer, size, "CLS");
+        break;
+    case CHIP8_OP_00EE:
+        snprintf(buffer, size, "RET");
+        break;
+    case CHIP8_OP_1nnn:
+        snprintf(buffer, size, "JP 0x%03X", address);
+        break;
+    case CHIP8_OP_2nnn:
+        snprintf(buffer, size, "CALL 0x%03X", address);
+        break;
+    case CHIP8_OP_3xkk:
+        snprintf(buffer, size, "SE V%X, 0x%02X", x, byte);
+        break;
+    case CHIP8_OP_4xkk:
+        snprintf(buffer, size, "SNE V%X, 0x%02X", x, byte);
+        break;
+    case CHIP8_OP_5xy0:
+        snprintf(buffer, size, "SE V%X, V%X", x, y);
+        break;
+    case CHIP8_OP_6xkk:
+        snprintf(buffer, size, "LD V%X, 0x%02X", x, byte);
+        break;
+    case CHIP8_OP_7xkk:
+        snprintf(buffer, size, "ADD V%X, 0x%02X", x, byte);
+        break;
+    case CHIP8_OP_8xy0:
+    case CHIP8_OP_8xy1:
+    case CHIP8_OP_8xy2:
+    case CHIP8_OP_8xy3:
+    case CHIP8_OP_8xy4:
+    case CHIP8_OP_8xy5:
+    case CHIP8_OP_8xy6:
+    case CHIP8_OP_8xy7:
+        snprintf(buffer, size, "%s V%X, V%X", alu[op - CHIP8_OP_8xy0], x, y);
+        break;
+    case CHIP8_OP_8xyE:
+        snprintf(buffer, size, "SHL V%X, V%X", x, y);
+        break;
+    case CHIP8_OP_9xy0:
+        snprintf(buffer, size, "SNE V%X, V%X", x, y);
+        break;
+    case CHIP8_OP_Annn:
+        snprintf(buffer, size, "LD I, 0x%03X", address);
+        break;
+    case CHIP8_OP_Bnnn:
+        snprintf(buffer, size, "JP V0, 0x%03X", address);
+        break;
+    case CHIP8_OP_Cxkk:
+        snprintf(buffer, size, "RND V%X, 0x%02X", x, byte);
+        break;
+    case CHIP8_OP_Dxyn:
+        snprintf(buffer, size, "DRW V%X, V%X, %u", x, y, n);
+        break;
+    case CHIP8_OP_Ex9E:
+        snprintf(buffer, size, "SKP V%X", x);
+        break;
+    case CHIP8_OP_ExA1:
+        snprintf(buffer, size, "SKNP V%X", x);
+        break;
+    case CHIP8_OP_Fx07:
+        snprintf(buffer, size, "LD V%X, DT", x);
+        break;
+    case CHIP8_OP_Fx0A:
+        snprintf(buffer, size, "LD V%X, K", x);
+        break;
+    case CHIP8_OP_Fx15:
+        snprintf(buffer, size, "LD DT, V%X", x);
+        break;
+    case CHIP8_OP_Fx18:
+        snprintf(buffer, size, "LD ST, V%X", x);
+        break;
+    case CHIP8_OP_Fx1E:
+        snprintf(buffer, size, "ADD I, V%X", x);
+        break;
+    case CHIP8_OP_Fx29:
+        snprintf(buffer, size, "LD F, V%X", x);
+        break;
+    case CHIP8_OP_Fx33:
+        snprintf(buffer, size, "LD B, V%X", x);
+        break;
+    case CHIP8_OP_Fx55:
+        snprintf(buffer, size, "LD [I], V%X", x);
+        break;
+    case CHIP8_OP_Fx65:
+        snprintf(buffer, size, "LD V%X, [I]", x);
+        break;
+    default:
+        snprintf(buffer, size, "???");
+    }
+}
+
+static void print_registers(struct Chip8 const *chip)
+{
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        printf("V%X=%02X%s", i, chip->registers[i], i % 8 == 7 ? "\n" : " ");
+    }
+    printf("I=%03X PC=%03X SP=%X DT=%02X ST=%02X\n", chip->index, chip->pc, chip->sp, chip->delay_timer,
+           chip->sound_timer);
+    for (uint8_t i = 0; i < chip->sp && i < 16; i++)
+    {
+        printf("stack[%X]=%03X\n", i, chip->stack[i]);
+    }
+}
+
+static void print_disassembly(struct Debugger const *dbg, struct Chip8 const *chip, unsigned int address,
+                              unsigned int count)
+{
+    for (unsigned int i = 0; i < count && address + 1 < sizeof(chip->memory); i++, address += 2)
+    {
+        char text[32];
+        uint16_t opcode = (chip->memory[address] << 8u) | chip->memory[address + 1];
+
+        chip8_disassemble(opcode, text, sizeof(text));
+        printf("%c%c %03X: %04X  %s\n", address == chip->pc ? '>' : ' ',
+               debugger_has_breakpoint(dbg, address) ? '*' : ' ', address, opcode, text);
+    }
+}
+
+static void print_memory(struct Chip8 const *chip, unsigned int address, unsigned int length)
+{
+    for (unsigned int i = 0; i < length && address + i < sizeof(chip->memory); i++)
+    {
+        if (i % 16 == 0)
+            printf("%s%03X:", i ? "\n" : "", address + i);
+        printf(" %02X", chip->memory[address + i]);
+    }
+    printf("\n");
+}
+
+static void print_points(struct Debugger const *dbg)
+{
+    static const char *ops[] = {"==", "!=", "<", ">", "<=", ">="};
+
+    for (unsigned int address = 0; address < 4096; address++)
+    {
+        if (debugger_has_breakpoint(dbg, address))
+            printf("break %03X\n", address);
+    }
+    for (unsigned int i = 0; i < dbg->watchpoint_count; i++)
+    {
+        struct Watchpoint const *watch = &dbg->watchpoints[i];
+        printf("watch %03X+%u %s%s\n", watch->start, watch->length, watch->access & WATCH_READ ? "r" : "",
+               watch->access & WATCH_WRITE ? "w" : "");
+    }
+    for (unsigned int i = 0; i < dbg->condition_count; i++)
+    {
+        struct Condition const *cond = &dbg->conditions[i];
+        printf("cond V%X %s %02X", cond->reg, ops[cond->op], cond->value);
+        if (cond->address >= 0)
+            printf(" at %03X", cond->address);
+        printf("\n");
+    }
+}
+
+static int parse_op(const char *text, enum condition_op *op)
+{
+    static const char *ops[] = {"==", "!=", "<", ">", "<=", ">="};
+
+    for (int i = 0; i < 6; i++)
+    {
+        if (strcmp(text, ops[i]) == 0)
+        {
+            *op = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void print_help(void)
+{
+    printf("c                  continue\n"
+           "s                  step one instruction\n"
+           "n                  step, running over CALL\n"
+           "b ADDR             set breakpoint\n"
+           "d ADDR             delete breakpoint\n"
+           "w ADDR [LEN] [rw]  watch memory reads and/or writes\n"
+           "dw                 delete all watchpoints\n"
+           "cond Vx OP VAL [ADDR]  break when Vx OP VAL (== != < > <= >=) becomes true, optionally only at ADDR\n"
+           "dc                 delete all conditions\n"
+           "l                  list breakpoints, watchpoints and conditions\n"
+           "r                  show registers\n"
+           "x [ADDR] [COUNT]   disassemble\n"
+           "m ADDR [LEN]       dump memory\n"
+           "t                  toggle instruction trace\n"
+           "q                  quit\n"
+           "numbers are hexadecimal\n");
+}
+
+char debugger_prompt(struct Debugger *dbg, struct Chip8 *chip, enum debug_event event, FILE *in)
+{
+    static const char *reasons[] = {"stopped", "breakpoint", "watchpoint", "condition", "step"};
+    char line[128];
+
+    printf("%s\n", reasons[event]);
+    print_disassembly(dbg, chip, chip->pc, 1);
+
+    while (1)
+    {
+        printf("(chip8) ");
+        fflush(stdout);
+
+        if (fgets(line, sizeof(line), in) == NULL)
+            return 1;
+
+        char cmd[16], a[16], b[16], c[16], d[16];
+        int args = sscanf(line, "%15s %15s %15s %15s %15s", cmd, a, b, c, d);
+
+        if (args <= 0)
+            continue;
+
+        if (strcmp(cmd, "c") == 0)
+        {
+            debugger_continue(dbg);
+            return 0;
+        }
+        else if (strcmp(cmd, "s") == 0)
+        {
+            debugger_step(dbg);
+            return 0;
+        }
+        else if (strcmp(cmd, "n") == 0)
+        {
+            debugger_step_over(dbg, chip);
+            return 0;
+        }
+        else if (strcmp(cmd, "b") == 0 && args >= 2)
+        {
+            debugger_set_breakpoint(dbg, strtoul(a, NULL, 16));
+        }
+        else if (strcmp(cmd, "d") == 0 && args >= 2)
+        {
+            debugger_clear_breakpoint(dbg, strtoul(a, NULL, 16));
+        }
+        else if (strcmp(cmd, "w") == 0 && args >= 2)
+        {
+            uint8_t access = WATCH_READ | WATCH_WRITE;
+            if (args >= 4)
+                access = (strchr(c, 'r') ? WATCH_READ : 0) | (strchr(c, 'w') ? WATCH_WRITE : 0);
+
+            if (!debugger_add_watchpoint(dbg, strtoul(a, NULL, 16), args >= 3 ? strtoul(b, NULL, 16) : 1, access))
+                printf("too many watchpoints\n");
+        }
+        else if (strcmp(cmd, "dw") == 0)
+        {
+            dbg->watchpoint_count = 0;
+            debugger_update(dbg);
+        }
+        else if (strcmp(cmd, "cond") == 0 && args >= 4 && (a[0] == 'V' || a[0] == 'v'))
+        {
+            struct Condition cond;
+            cond.reg = strtoul(a + 1, NULL, 16) & 0xFu;
+            cond.value = strtoul(c, NULL, 16);
+            cond.address = args >= 5 ? (int)(strtoul(d, NULL, 16) & 0x0FFFu) : -1;
+
+            if (!parse_op(b, &cond.op))
+                printf("unknown operator %s\n", b);
+            else if (!debugger_add_condition(dbg, cond))
+                printf("too many conditions\n");
+        }
+        else if (strcmp(cmd, "dc") == 0)
+        {
+            dbg->condition_count = 0;
+            debugger_update(dbg);
+        }
+        else if (strcmp(cmd, "l") == 0)
+        {
+            print_points(dbg);
+        }
+        else if (strcmp(cmd, "r") == 0)
+        {
+            print_registers(chip);
+        }
+        else if (strcmp(cmd, "x") == 0)
+        {
+            print_disassembly(dbg, chip, args >= 2 ? strtoul(a, NULL, 16) : chip->pc,
+                              args >= 3 ? strtoul(b, NULL, 16) : 10);
+        }
+        else if (strcmp(cmd, "m") == 0 && args >= 2)
+        {
+            print_memory(chip, strtoul(a, NULL, 16), args >= 3 ? strtoul(b, NULL, 16) : 16);
+        }
+        else if (strcmp(cmd, "t") == 0)
+        {
+            dbg->trace = !dbg->trace;
+            debugger_update(dbg);
+            printf("trace %s\n", dbg->trace ? "on" : "off");
+        }
+        else if (strcmp(cmd, "q") == 0)
+        {
+            return 1;
+        }
+        else
+        {
+            print_help();
+        }
+    }
+}
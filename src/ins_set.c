@@ -9,11 +9,28 @@ void OP_NULL(struct Chip8 *chip)
 {
 }
 
+// here rather than in chip8.c so OP_Dxyn can inline it
+uint64_t chip8_row_hash(uint64_t bits, unsigned int row)
+{
+    // splitmix64 finalizer, the row number keeps equal rows at different heights apart
+    uint64_t hash = bits + (row + 1) * 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
 // 00E0: CLS
 // clear the display
 void OP_00E0(struct Chip8 *chip)
 {
     memset(&chip->video, 0, sizeof(chip->video));
+    memset(&chip->video_rows, 0, sizeof(chip->video_rows));
+
+    chip->video_digest = 0;
+    for (uint8_t row = 0; row < VIDEO_HEIGHT; row++)
+    {
+        chip->video_digest ^= chip8_row_hash(0, row);
+    }
 }
 
 // 00EE: RET
@@ -21,7 +38,7 @@ void OP_00E0(struct Chip8 *chip)
 void OP_00EE(struct Chip8 *chip)
 {
     chip->sp--;
-    chip->pc = chip->stack[chip->sp];
+    chip->pc = chip->stack[chip->sp & 0xFu];
 }
 
 // 1nnn: JP addr
@@ -38,7 +55,8 @@ void OP_2nnn(struct Chip8 *chip)
 {
     uint16_t address = chip->opcode & 0x0FFFu;
 
-    chip->stack[chip->sp] = chip->pc;
+    // wraps instead of writing past the stack
+    chip->stack[chip->sp & 0xFu] = chip->pc;
     chip->sp++;
     chip->pc = address;
 }
@@ -250,7 +268,12 @@ void OP_Cxkk(struct Chip8 *chip)
     uint8_t Vx = (chip->opcode & 0x0F00u) >> 8u;
     uint8_t byte = chip->opcode & 0x00FFu;
 
-    chip->registers[Vx] = (rand() % 255) & byte;
+    // xorshift32, kept per chip instead of rand() so chips dont share state
+    chip->rng ^= chip->rng << 13u;
+    chip->rng ^= chip->rng >> 17u;
+    chip->rng ^= chip->rng << 5u;
+
+    chip->registers[Vx] = (chip->rng % 255) & byte;
 }
 
 // Dxyn: DRW Vx, Vy, nibble (height)
@@ -266,26 +289,36 @@ void OP_Dxyn(struct Chip8 *chip)
 
     chip->registers[0xF] = 0;
 
-    // iterating each byte/ row of sprite
-    for (uint8_t row = 0; row < height; row++)
+    // iterating each byte/ row of sprite, clipped at the bottom edge
+    for (uint8_t row = 0; row < height && y_pos + row < VIDEO_HEIGHT; row++)
     {
-        uint8_t sprite_byte = chip->memory[chip->index + row];
+        uint8_t sprite_byte = chip->memory[(chip->index + row) & 0x0FFFu];
+        uint8_t y = y_pos + row;
 
-        // iterating each bit/ col of a sprite byte/ row
-        for (uint8_t col = 0; col < 8; col++)
+        // the same row as bits, those past the right edge are shifted out like the clipped columns
+        uint64_t bits = ((uint64_t)sprite_byte << 56u) >> x_pos;
+        if (bits == 0)
+            continue;
+
+        // collision
+        if (chip->video_rows[y] & bits)
+        {
+            chip->registers[0xF] = 1;
+        }
+
+        chip->video_digest ^= chip8_row_hash(chip->video_rows[y], y);
+        chip->video_rows[y] ^= bits;
+        chip->video_digest ^= chip8_row_hash(chip->video_rows[y], y);
+
+        // iterating each bit/ col of a sprite byte/ row, clipped at the right edge
+        for (uint8_t col = 0; col < 8 && x_pos + col < VIDEO_WIDTH; col++)
         {
             uint8_t sprite_pixel = sprite_byte & (0x80 >> col);
-            uint32_t *video_pixel = &chip->video[((y_pos + row) * VIDEO_WIDTH) + (x_pos + col)];
 
             if (sprite_pixel)
             {
-                // collision
-                if (*video_pixel == 0xFFFFFFFF)
-                {
-                    chip->registers[0xF] = 1;
-                }
                 // XORing
-                *video_pixel ^= 0xFFFFFFFF;
+                chip->video[(y * VIDEO_WIDTH) + (x_pos + col)] ^= 0xFFFFFFFF;
             }
         }
     }
@@ -296,7 +329,7 @@ void OP_Dxyn(struct Chip8 *chip)
 void OP_Ex9E(struct Chip8 *chip)
 {
     uint8_t Vx = (chip->opcode & 0x0F00u) >> 8u;
-    uint8_t key = chip->registers[Vx];
+    uint8_t key = chip->registers[Vx] & 0xFu;
 
     if (chip->keypad[key])
     {
@@ -309,7 +342,7 @@ void OP_Ex9E(struct Chip8 *chip)
 void OP_ExA1(struct Chip8 *chip)
 {
     uint8_t Vx = (chip->opcode & 0x0F00u) >> 8u;
-    uint8_t key = chip->registers[Vx];
+    uint8_t key = chip->registers[Vx] & 0xFu;
 
     if (!chip->keypad[key])
     {
@@ -388,15 +421,15 @@ void OP_Fx33(struct Chip8 *chip)
     uint8_t value = chip->registers[Vx];
 
     // ones place
-    chip->memory[chip->index + 2] = value % 10;
+    chip->memory[(chip->index + 2) & 0x0FFFu] = value % 10;
     value /= 10;
 
     // tens place
-    chip->memory[chip->index + 1] = value % 10;
+    chip->memory[(chip->index + 1) & 0x0FFFu] = value % 10;
     value /= 10;
 
     // hundreds place
-    chip->memory[chip->index] = value % 10;
+    chip->memory[chip->index & 0x0FFFu] = value % 10;
 }
 
 // Fx55: LD [I], Vx
@@ -407,7 +440,7 @@ void OP_Fx55(struct Chip8 *chip)
 
     for (uint8_t i = 0; i < Vx; i++)
     {
-        chip->memory[chip->index + i] = chip->registers[i];
+        chip->memory[(chip->index + i) & 0x0FFFu] = chip->registers[i];
     }
 }
 
@@ -419,6 +452,123 @@ void OP_Fx65(struct Chip8 *chip)
 
     for (uint8_t i = 0; i < Vx; i++)
     {
-        chip->registers[i] = chip->memory[chip->index + i];
+        chip->registers[i] = chip->memory[(chip->index + i) & 0x0FFFu];
+    }
+}
+
+// superinstructions, run by chip8_run() in place of two or more dispatches
+// each one executes the same OP_* handlers in the same order as chip8_cycle() would,
+// chip8_run() ticks the timers for every instruction they report
+
+// chip8_fetch(), kept here so the superinstructions can inline it
+static uint16_t fetch(struct Chip8 const *chip, unsigned int address)
+{
+    return (chip->memory[address & 0x0FFFu] << 8u) | chip->memory[(address + 1) & 0x0FFFu];
+}
+
+// runs the instruction at pc
+static void step(struct Chip8 *chip, uint16_t opcode, chip8_ins handler)
+{
+    chip->opcode = opcode;
+    chip->pc += 2;
+    handler(chip);
+}
+
+// 3xkk/4xkk, 1nnn: conditional branch
+unsigned int OP_FUSED_branch(struct Chip8 *chip, unsigned int budget)
+{
+    uint16_t skip = fetch(chip, chip->pc);
+    uint16_t jump = fetch(chip, chip->pc + 2);
+
+    if ((jump & 0xF000u) != 0x1000u)
+        return 0;
+
+    uint16_t next = chip->pc + 2;
+    if ((skip & 0xF000u) == 0x3000u)
+        step(chip, skip, &OP_3xkk);
+    else
+        step(chip, skip, &OP_4xkk);
+    // the jump was skipped
+    if (chip->pc != next)
+    {
+        chip->fusion_partial[CHIP8_FUSE_BRANCH]++;
+        return 1;
+    }
+
+    chip->fusion_counts[CHIP8_FUSE_BRANCH]++;
+    step(chip, jump, &OP_1nnn);
+    return 2;
+}
+
+// Annn, Dxyn: draw the sprite at a fixed address
+unsigned int OP_FUSED_Annn_Dxyn(struct Chip8 *chip, unsigned int budget)
+{
+    uint16_t load = fetch(chip, chip->pc);
+    uint16_t draw = fetch(chip, chip->pc + 2);
+
+    if ((draw & 0xF000u) != 0xD000u)
+        return 0;
+
+    chip->fusion_counts[CHIP8_FUSE_SPRITE]++;
+    step(chip, load, &OP_Annn);
+    step(chip, draw, &OP_Dxyn);
+    return 2;
+}
+
+// 6xkk, 6xkk, ...: register initialisation
+unsigned int OP_FUSED_6xkk_run(struct Chip8 *chip, unsigned int budget)
+{
+    unsigned int count = 1;
+
+    while (count < budget && (fetch(chip, chip->pc + count * 2) & 0xF000u) == 0x6000u)
+    {
+        count++;
+    }
+
+    if (count < 2)
+        return 0;
+
+    chip->fusion_counts[CHIP8_FUSE_LOAD_RUN]++;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        step(chip, fetch(chip, chip->pc), &OP_6xkk);
+    }
+    return count;
+}
+
+// Fx29, Dxyn: draw a digit
+unsigned int OP_FUSED_Fx29_Dxyn(struct Chip8 *chip, unsigned int budget)
+{
+    uint16_t font = fetch(chip, chip->pc);
+    uint16_t draw = fetch(chip, chip->pc + 2);
+
+    if ((draw & 0xF000u) != 0xD000u)
+        return 0;
+
+    chip->fusion_counts[CHIP8_FUSE_DIGIT]++;
+    step(chip, font, &OP_Fx29);
+    step(chip, draw, &OP_Dxyn);
+    return 2;
+}
+
+// Fx33, Fx65: split a score into digits
+unsigned int OP_FUSED_Fx33_Fx65(struct Chip8 *chip, unsigned int budget)
+{
+    uint16_t bcd = fetch(chip, chip->pc);
+    uint16_t load = fetch(chip, chip->pc + 2);
+
+    if ((load & 0xF0FFu) != 0xF065u)
+        return 0;
+
+    step(chip, bcd, &OP_Fx33);
+    // Fx33 wrote over the Fx65, let the interpreter fetch whatever is there now
+    if (fetch(chip, chip->pc) != load)
+    {
+        chip->fusion_partial[CHIP8_FUSE_BCD]++;
+        return 1;
     }
+
+    chip->fusion_counts[CHIP8_FUSE_BCD]++;
+    step(chip, load, &OP_Fx65);
+    return 2;
 }
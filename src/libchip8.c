@@ -0,0 +1,114 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "chip8.h"
+#include "libchip8.h"
+
+struct Chip8Instance
+{
+    struct Chip8 chip;
+    uint32_t seed;
+    unsigned int cycles_per_frame;
+    char loaded;
+};
+
+struct Chip8Instance *chip8_create(void)
+{
+    struct Chip8Instance *instance = malloc(sizeof(*instance));
+
+    if (instance == NULL)
+    {
+        return NULL;
+    }
+
+    chip8_init(&instance->chip);
+    instance->seed = 1;
+    instance->cycles_per_frame = CHIP8_CYCLES_PER_FRAME;
+    instance->loaded = 0;
+
+    return instance;
+}
+
+void chip8_destroy(struct Chip8Instance *instance)
+{
+    free(instance);
+}
+
+void chip8_set_seed(struct Chip8Instance *instance, uint32_t seed)
+{
+    instance->seed = seed;
+    chip8_seed(&instance->chip, seed);
+}
+
+void chip8_set_cycles_per_frame(struct Chip8Instance *instance, unsigned int cycles)
+{
+    instance->cycles_per_frame = cycles;
+}
+
+int chip8_load_rom_from_memory(struct Chip8Instance *instance, uint8_t const *data, size_t size)
+{
+    if (size > CHIP8_MAX_ROM_SIZE)
+    {
+        return CHIP8_ERR_ROM_TOO_LARGE;
+    }
+
+    chip8_init(&instance->chip);
+    chip8_seed(&instance->chip, instance->seed);
+
+    int error = chip8_load_rom_data(&instance->chip, data, size);
+    instance->loaded = error == CHIP8_OK;
+
+    return error;
+}
+
+int chip8_run_cycles(struct Chip8Instance *instance, unsigned int cycles)
+{
+    if (!instance->loaded)
+    {
+        return CHIP8_ERR_NO_ROM;
+    }
+
+    chip8_run(&instance->chip, cycles);
+
+    return CHIP8_OK;
+}
+
+int chip8_run_frame(struct Chip8Instance *instance)
+{
+    return chip8_run_cycles(instance, instance->cycles_per_frame);
+}
+
+uint32_t const *chip8_get_framebuffer(struct Chip8Instance const *instance, unsigned int *width,
+                                      unsigned int *height)
+{
+    if (width)
+        *width = VIDEO_WIDTH;
+    if (height)
+        *height = VIDEO_HEIGHT;
+
+    return instance->chip.video;
+}
+
+uint64_t chip8_get_frame_digest(struct Chip8Instance const *instance)
+{
+    return chip8_frame_digest(&instance->chip);
+}
+
+uint64_t const *chip8_get_frame_rows(struct Chip8Instance const *instance)
+{
+    return instance->chip.video_rows;
+}
+
+void chip8_set_keys(struct Chip8Instance *instance, uint16_t keys)
+{
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        instance->chip.keypad[i] = (keys >> i) & 1u;
+    }
+}
+
+void chip8_write_fusion_report(struct Chip8Instance const *instance, FILE *out)
+{
+    chip8_fusion_report(&instance->chip, out);
+}
@@ -1,16 +1,33 @@
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "chip8.h"
+#include "debugger.h"
+#include "metrics.h"
 #include "platform.h"
+#include "shm_export.h"
+
+// set by ctrl+c while debugging, breaks into the prompt
+static volatile sig_atomic_t break_requested = 0;
+
+static void request_break(int signal)
+{
+    break_requested = 1;
+}
+
+#ifdef CHIP8_AOT
+#include "aot.h"
+#endif
 
-extern uint8_t KEYPAD_MAP[128];
 int main(int argc, char **argv)
 {
     if (argc < 4)
     {
-        printf("args required: scale, delay, rom\n");
+        printf("args required: scale, delay, rom [--debug] [--shm NAME] [--metrics FILE] [--overlay] "
+               "[--profile PREFIX] [--run-ahead FRAMES] [--cycles N]\n");
         exit(-1);
     }
 
@@ -18,23 +35,163 @@ int main(int argc, char **argv)
     unsigned int cycle_delay = atoi(argv[2]);
     char const *rom_filename = argv[3];
 
+    char debug = 0;
+    char const *shm_name = NULL;
+    char const *metrics_filename = NULL;
+    char overlay = 0;
+    char const *profile_prefix = NULL;
+    unsigned int run_ahead = 0;
+    // instructions per frame, a frame being one tick of `cycle_delay` followed by one present
+    unsigned int cycles_per_frame = 1;
+    for (int i = 4; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--debug") == 0)
+        {
+            debug = 1;
+        }
+        else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc)
+        {
+            shm_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+        {
+            metrics_filename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--overlay") == 0)
+        {
+            overlay = 1;
+        }
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+        {
+            profile_prefix = argv[++i];
+        }
+        else if (strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc)
+        {
+            run_ahead = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc)
+        {
+            cycles_per_frame = atoi(argv[++i]);
+        }
+    }
+
+#ifndef CHIP8_PROFILE
+    if (profile_prefix)
+    {
+        printf("--profile needs a build with CHIP8_PROFILE (make PROFILE=1)\n");
+        exit(-1);
+    }
+#endif
+
     struct Platform platform;
     platform_init(&platform, "Chip8 Emulator", VIDEO_WIDTH * video_scale, VIDEO_HEIGHT * video_scale, VIDEO_WIDTH,
                   VIDEO_HEIGHT);
 
     struct Chip8 chip;
     chip8_init(&chip);
-    chip8_load_rom(&chip, rom_filename);
+    chip8_seed(&chip, time(NULL));
+
+    int error = chip8_load_rom(&chip, rom_filename);
+    if (error != CHIP8_OK)
+    {
+        printf("%s: %s\n", rom_filename, chip8_error_string(error));
+        platform_destroy(&platform);
+        exit(-1);
+    }
+
+    // publishes every presented frame for out-of-process readers
+    struct ShmExport shm = {NULL};
+    if (shm_name)
+    {
+        error = shm_export_open(&shm, shm_name);
+        if (error != CHIP8_OK)
+        {
+            printf("%s: %s\n", shm_name, chip8_error_string(error));
+            platform_destroy(&platform);
+            exit(-1);
+        }
+    }
+
+    // telemetry is only recorded when something consumes it
+    char telemetry = metrics_filename || overlay;
+    struct Metrics metrics;
+    metrics_init(&metrics, metrics_now());
+    uint64_t next_export = metrics.start + 1000000000ull;
+    if (overlay)
+    {
+        platform_set_overlay(&platform, metrics.bars, METRICS_BARS);
+    }
 
     unsigned int video_pitch = sizeof(chip.video[0]) * VIDEO_WIDTH;
 
+    // run-ahead presents a copy of the machine emulated this many frames further with the keys held now,
+    // so a rom that polls the keypad shows its reaction that much earlier; the real machine is never touched
+    struct Chip8 *ahead = NULL;
+    if (run_ahead)
+    {
+        ahead = malloc(sizeof(*ahead));
+        if (ahead == NULL)
+        {
+            printf("%s\n", chip8_error_string(CHIP8_ERR_NO_MEMORY));
+            platform_destroy(&platform);
+            exit(-1);
+        }
+        chip8_init(ahead);
+    }
+
     clock_t last_cycle_time = clock();
 
     char quit = 0;
 
+    struct Debugger dbg;
+    debugger_init(&dbg);
+    if (debug)
+    {
+        // stop before the first instruction
+        dbg.break_next = 1;
+        debugger_update(&dbg);
+        signal(SIGINT, request_break);
+    }
+
+#ifdef CHIP8_AOT
+    // a different rom than the one translated runs fully interpreted
+    char aot_disabled = !chip8_aot_intact(&chip);
+#endif
+
     while (!quit)
     {
+        uint8_t keypad[16];
+        if (telemetry)
+        {
+            memcpy(keypad, chip.keypad, sizeof(keypad));
+        }
+
         quit = process_input(&platform, chip.keypad);
+
+        if (telemetry)
+        {
+            uint64_t now = metrics_now();
+            if (memcmp(keypad, chip.keypad, sizeof(keypad)) != 0)
+            {
+                metrics_input(&metrics, now);
+            }
+
+            if (now >= next_export)
+            {
+                next_export = now + 1000000000ull;
+                if (metrics_export(&metrics, metrics_filename, now) != CHIP8_OK)
+                {
+                    printf("%s: %s\n", metrics_filename, chip8_error_string(CHIP8_ERR_FILE));
+                    metrics_filename = NULL;
+                }
+                if (overlay)
+                {
+                    char title[128];
+                    metrics_summary(&metrics, title, sizeof(title));
+                    platform_set_title(&platform, title);
+                }
+            }
+        }
         clock_t curr_cycle_time = clock();
 
         // find time diff and convert it to milli seconds
@@ -43,12 +200,103 @@ int main(int argc, char **argv)
         if (delay > cycle_delay)
         {
             last_cycle_time = curr_cycle_time;
-            chip8_cycle(&chip);
 
-            update_window(&platform, chip.video, video_pitch);
+            if (break_requested)
+            {
+                break_requested = 0;
+                dbg.break_next = 1;
+                debugger_update(&dbg);
+            }
+
+            unsigned int remaining = cycles_per_frame;
+
+            // the checked path is only switched in while something is being watched
+            while (remaining > 0 && dbg.active)
+            {
+                enum debug_event event = debugger_cycle(&dbg, &chip);
+                if (event != DEBUG_NONE)
+                {
+                    quit |= debugger_prompt(&dbg, &chip, event, stdin);
+                    // show the screen before going on
+                    break;
+                }
+                metrics.instructions++;
+                remaining--;
+            }
+
+            if (!dbg.active && !quit)
+            {
+#ifdef CHIP8_AOT
+                chip8_aot_execute(&chip, remaining, &aot_disabled);
+#else
+                chip8_run(&chip, remaining);
+#endif
+                metrics.instructions += remaining;
+            }
+
+            // once per frame, not while debugging since the prompt shows the real machine
+            struct Chip8 const *presented = &chip;
+            if (ahead && !dbg.active)
+            {
+                uint64_t ahead_start = metrics_now();
+                chip8_copy_state(ahead, &chip);
+                chip8_run(ahead, run_ahead * cycles_per_frame);
+                histogram_record(&metrics.run_ahead_time, metrics_now() - ahead_start);
+                presented = ahead;
+            }
+            uint32_t const *frame = presented->video;
+
+            if (telemetry)
+            {
+                uint64_t present_start = metrics_now();
+                update_window(&platform, frame, video_pitch);
+                metrics_present(&metrics, present_start, metrics_now());
+            }
+            else
+            {
+                update_window(&platform, frame, video_pitch);
+            }
+
+            if (shm.frame)
+            {
+                // what is on screen, so with run-ahead the registers are the predicted ones too
+                shm_export_publish(&shm, presented);
+            }
         }
     }
 
+    if (metrics_filename)
+    {
+        metrics_export(&metrics, metrics_filename, metrics_now());
+    }
+
+    if (ahead)
+    {
+        struct Histogram const *time = &metrics.run_ahead_time;
+        if (time->total)
+        {
+            printf("run-ahead %u frames: %llu presents, mean %.1f us, p99 %.1f us, max %.1f us\n", run_ahead,
+                   (unsigned long long)time->total, time->sum / 1e3 / time->total,
+                   histogram_quantile(time, 0.99) / 1e3, time->max / 1e3);
+        }
+        free(ahead);
+    }
+
+#ifdef CHIP8_PROFILE
+    if (profile_prefix)
+    {
+        char filename[256];
+        snprintf(filename, sizeof(filename), "%s.txt", profile_prefix);
+        error = chip8_profile_write_report(&chip, filename);
+        if (error != CHIP8_OK)
+            printf("%s: %s\n", filename, chip8_error_string(error));
+        snprintf(filename, sizeof(filename), "%s.folded", profile_prefix);
+        if (chip8_profile_write_folded(&chip, filename) != CHIP8_OK)
+            printf("%s: %s\n", filename, chip8_error_string(CHIP8_ERR_FILE));
+    }
+#endif
+
+    shm_export_close(&shm);
     platform_destroy(&platform);
     return 0;
 }
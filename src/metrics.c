@@ -0,0 +1,245 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "chip8.h"
+#include "metrics.h"
+
+// length of one 60 Hz frame
+#define FRAME_NS 16666667ull
+
+uint64_t metrics_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void metrics_init(struct Metrics *metrics, uint64_t now)
+{
+    memset(metrics, 0, sizeof(*metrics));
+    metrics->start = now;
+    metrics->last_export = now;
+    metrics->frame_time.min = UINT64_MAX;
+    metrics->present_time.min = UINT64_MAX;
+    metrics->input_latency.min = UINT64_MAX;
+    metrics->run_ahead_time.min = UINT64_MAX;
+}
+
+void metrics_input(struct Metrics *metrics, uint64_t now)
+{
+    // latency is measured from the first change since the last present
+    if (metrics->pending_input == 0)
+    {
+        metrics->pending_input = now;
+    }
+}
+
+void metrics_present(struct Metrics *metrics, uint64_t start, uint64_t end)
+{
+    metrics->frames_presented++;
+    histogram_record(&metrics->present_time, end - start);
+
+    if (metrics->pending_input)
+    {
+        histogram_record(&metrics->input_latency, end - metrics->pending_input);
+        metrics->pending_input = 0;
+    }
+
+    if (metrics->last_present)
+    {
+        uint64_t frame_time = end - metrics->last_present;
+        histogram_record(&metrics->frame_time, frame_time);
+
+        // rounded to whole frames so jitter around 16.7 ms doesnt count as a skip
+        uint64_t slots = (frame_time + FRAME_NS / 2) / FRAME_NS;
+        if (slots > 1)
+        {
+            metrics->frames_skipped += slots - 1;
+        }
+
+        uint64_t bar = frame_time * 128 / FRAME_NS;
+        memmove(metrics->bars, metrics->bars + 1, METRICS_BARS - 1);
+        metrics->bars[METRICS_BARS - 1] = bar > 255 ? 255 : bar;
+    }
+    metrics->last_present = end;
+}
+
+void metrics_merge(struct Metrics *into, struct Metrics const *from)
+{
+    into->instructions += from->instructions;
+    into->frames_presented += from->frames_presented;
+    into->frames_skipped += from->frames_skipped;
+    into->instructions_per_second += from->instructions_per_second;
+    into->frames_per_second += from->frames_per_second;
+    histogram_merge(&into->frame_time, &from->frame_time);
+    histogram_merge(&into->present_time, &from->present_time);
+    histogram_merge(&into->input_latency, &from->input_latency);
+    histogram_merge(&into->run_ahead_time, &from->run_ahead_time);
+}
+
+static void write_histogram(FILE *out, const char *name, struct Histogram const *histogram)
+{
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    static const char *labels[] = {"p50", "p90", "p99", "p999"};
+
+    fprintf(out, "%s_count %llu\n", name, (unsigned long long)histogram->total);
+    if (histogram->total == 0)
+    {
+        return;
+    }
+
+    fprintf(out, "%s_min_us %.1f\n", name, histogram->min / 1e3);
+    fprintf(out, "%s_mean_us %.1f\n", name, (double)histogram->sum / histogram->total / 1e3);
+    for (int i = 0; i < 4; i++)
+    {
+        fprintf(out, "%s_%s_us %.1f\n", name, labels[i], histogram_quantile(histogram, quantiles[i]) / 1e3);
+    }
+    fprintf(out, "%s_max_us %.1f\n", name, histogram->max / 1e3);
+}
+
+int metrics_export(struct Metrics *metrics, const char *filename, uint64_t now)
+{
+    double interval = (now - metrics->last_export) / 1e9;
+    if (interval > 0)
+    {
+        metrics->instructions_per_second = (metrics->instructions - metrics->last_export_instructions) / interval;
+        metrics->frames_per_second = (metrics->frames_presented - metrics->last_export_frames) / interval;
+    }
+    metrics->last_export = now;
+    metrics->last_export_instructions = metrics->instructions;
+    metrics->last_export_frames = metrics->frames_presented;
+
+    if (filename == NULL)
+    {
+        return CHIP8_OK;
+    }
+
+    // written next to the target and renamed, so readers never see half a file
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+
+    FILE *out = fopen(tmp, "w");
+    if (out == NULL)
+    {
+        return CHIP8_ERR_FILE;
+    }
+
+    double uptime = (now - metrics->start) / 1e9;
+
+    fprintf(out, "uptime_seconds %.3f\n", uptime);
+    fprintf(out, "instructions_total %llu\n", (unsigned long long)metrics->instructions);
+    fprintf(out, "instructions_per_second %.0f\n", metrics->instructions_per_second);
+    fprintf(out, "frames_presented_total %llu\n", (unsigned long long)metrics->frames_presented);
+    fprintf(out, "frames_per_second %.1f\n", metrics->frames_per_second);
+    fprintf(out, "frames_skipped_total %llu\n", (unsigned long long)metrics->frames_skipped);
+    // chip8_cycle() ticks the timers once per instruction, against a nominal 60 Hz
+    fprintf(out, "timer_ticks_total %llu\n", (unsigned long long)metrics->instructions);
+    fprintf(out, "timer_drift_ms %.1f\n", (metrics->instructions / 60.0 - uptime) * 1e3);
+    write_histogram(out, "frame_time", &metrics->frame_time);
+    write_histogram(out, "present_time", &metrics->present_time);
+    write_histogram(out, "input_latency", &metrics->input_latency);
+    if (metrics->run_ahead_time.total)
+    {
+        write_histogram(out, "run_ahead_time", &metrics->run_ahead_time);
+    }
+
+    int error = ferror(out);
+    fclose(out);
+
+    if (error || rename(tmp, filename) != 0)
+    {
+        return CHIP8_ERR_FILE;
+    }
+    return CHIP8_OK;
+}
+
+void metrics_summary(struct Metrics const *metrics, char *buffer, int size)
+{
+    int length = snprintf(buffer, size, "Chip8 Emulator - %.0f ips, %.1f fps, present p99 %.2f ms, skipped %llu",
+                          metrics->instructions_per_second, metrics->frames_per_second,
+                          histogram_quantile(&metrics->present_time, 0.99) / 1e6,
+                          (unsigned long long)metrics->frames_skipped);
+
+    if (metrics->run_ahead_time.total && length >= 0 && length < size)
+    {
+        snprintf(buffer + length, size - length, ", run-ahead p99 %.2f ms",
+                 histogram_quantile(&metrics->run_ahead_time, 0.99) / 1e6);
+    }
+}
+
+static unsigned int bucket_index(uint64_t value)
+{
+    if (value < (1u << HISTOGRAM_SUB_BITS))
+    {
+        return value;
+    }
+
+    unsigned int msb = 63 - __builtin_clzll(value);
+    unsigned int shift = msb - HISTOGRAM_SUB_BITS;
+
+    return ((shift + 1) << HISTOGRAM_SUB_BITS) + ((value >> shift) & ((1u << HISTOGRAM_SUB_BITS) - 1));
+}
+
+static uint64_t bucket_upper_bound(unsigned int index)
+{
+    if (index < (1u << HISTOGRAM_SUB_BITS))
+    {
+        return index;
+    }
+
+    unsigned int shift = (index >> HISTOGRAM_SUB_BITS) - 1;
+    uint64_t mantissa = (index & ((1u << HISTOGRAM_SUB_BITS) - 1)) | (1u << HISTOGRAM_SUB_BITS);
+
+    return (mantissa << shift) + (1ull << shift) - 1;
+}
+
+void histogram_record(struct Histogram *histogram, uint64_t value)
+{
+    histogram->counts[bucket_index(value)]++;
+    histogram->total++;
+    histogram->sum += value;
+    if (value < histogram->min)
+        histogram->min = value;
+    if (value > histogram->max)
+        histogram->max = value;
+}
+
+uint64_t histogram_quantile(struct Histogram const *histogram, double quantile)
+{
+    if (histogram->total == 0)
+    {
+        return 0;
+    }
+
+    uint64_t target = quantile * histogram->total;
+    if (target < 1)
+        target = 1;
+
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += histogram->counts[i];
+        if (seen >= target)
+        {
+            uint64_t bound = bucket_upper_bound(i);
+            return bound < histogram->max ? bound : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void histogram_merge(struct Histogram *into, struct Histogram const *from)
+{
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        into->counts[i] += from->counts[i];
+    }
+    into->total += from->total;
+    into->sum += from->sum;
+    if (from->min < into->min)
+        into->min = from->min;
+    if (from->max > into->max)
+        into->max = from->max;
+}
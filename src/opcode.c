@@ -0,0 +1,100 @@
+#include <stdint.h>
+
+#include "opcode.h"
+
+static const struct
+{
+    const char *name;
+    unsigned int flags;
+} ops[CHIP8_OP_COUNT] = {
+    [CHIP8_OP_NULL] = {"NULL", 0},
+    [CHIP8_OP_00E0] = {"00E0", 0},
+    [CHIP8_OP_00EE] = {"00EE", CHIP8_OPF_RETURN},
+    [CHIP8_OP_1nnn] = {"1nnn", CHIP8_OPF_JUMP},
+    [CHIP8_OP_2nnn] = {"2nnn", CHIP8_OPF_CALL},
+    [CHIP8_OP_3xkk] = {"3xkk", CHIP8_OPF_SKIP},
+    [CHIP8_OP_4xkk] = {"4xkk", CHIP8_OPF_SKIP},
+    [CHIP8_OP_5xy0] = {"5xy0", CHIP8_OPF_SKIP},
+    [CHIP8_OP_6xkk] = {"6xkk", 0},
+    [CHIP8_OP_7xkk] = {"7xkk", 0},
+    [CHIP8_OP_8xy0] = {"8xy0", 0},
+    [CHIP8_OP_8xy1] = {"8xy1", 0},
+    [CHIP8_OP_8xy2] = {"8xy2", 0},
+    [CHIP8_OP_8xy3] = {"8xy3", 0},
+    [CHIP8_OP_8xy4] = {"8xy4", 0},
+    [CHIP8_OP_8xy5] = {"8xy5", 0},
+    [CHIP8_OP_8xy6] = {"8xy6", 0},
+    [CHIP8_OP_8xy7] = {"8xy7", 0},
+    [CHIP8_OP_8xyE] = {"8xyE", 0},
+    [CHIP8_OP_9xy0] = {"9xy0", CHIP8_OPF_SKIP},
+    [CHIP8_OP_Annn] = {"Annn", 0},
+    [CHIP8_OP_Bnnn] = {"Bnnn", CHIP8_OPF_INDIRECT},
+    [CHIP8_OP_Cxkk] = {"Cxkk", 0},
+    [CHIP8_OP_Dxyn] = {"Dxyn", CHIP8_OPF_READ},
+    [CHIP8_OP_Ex9E] = {"Ex9E", CHIP8_OPF_SKIP},
+    [CHIP8_OP_ExA1] = {"ExA1", CHIP8_OPF_SKIP},
+    [CHIP8_OP_Fx07] = {"Fx07", 0},
+    [CHIP8_OP_Fx0A] = {"Fx0A", CHIP8_OPF_WAIT},
+    [CHIP8_OP_Fx15] = {"Fx15", 0},
+    [CHIP8_OP_Fx18] = {"Fx18", 0},
+    [CHIP8_OP_Fx1E] = {"Fx1E", 0},
+    [CHIP8_OP_Fx29] = {"Fx29", 0},
+    [CHIP8_OP_Fx33] = {"Fx33", CHIP8_OPF_WRITE},
+    [CHIP8_OP_Fx55] = {"Fx55", CHIP8_OPF_WRITE},
+    [CHIP8_OP_Fx65] = {"Fx65", CHIP8_OPF_READ},
+};
+
+enum chip8_op chip8_decode(uint16_t opcode)
+{
+    // prefixes decoded by the first nibble alone
+    static const enum chip8_op prefix[0xF + 1] = {
+        CHIP8_OP_NULL, CHIP8_OP_1nnn, CHIP8_OP_2nnn, CHIP8_OP_3xkk, CHIP8_OP_4xkk, CHIP8_OP_5xy0,
+        CHIP8_OP_6xkk, CHIP8_OP_7xkk, CHIP8_OP_NULL, CHIP8_OP_9xy0, CHIP8_OP_Annn, CHIP8_OP_Bnnn,
+        CHIP8_OP_Cxkk, CHIP8_OP_Dxyn, CHIP8_OP_NULL, CHIP8_OP_NULL};
+    unsigned int n = opcode & 0x000Fu;
+
+    switch (opcode >> 12u)
+    {
+    case 0x0:
+        return n == 0x0 ? CHIP8_OP_00E0 : n == 0xE ? CHIP8_OP_00EE : CHIP8_OP_NULL;
+    case 0x8:
+        return n <= 0x7 ? CHIP8_OP_8xy0 + n : n == 0xE ? CHIP8_OP_8xyE : CHIP8_OP_NULL;
+    case 0xE:
+        return n == 0xE ? CHIP8_OP_Ex9E : n == 0x1 ? CHIP8_OP_ExA1 : CHIP8_OP_NULL;
+    case 0xF:
+        switch (opcode & 0x00FFu)
+        {
+        case 0x07:
+            return CHIP8_OP_Fx07;
+        case 0x0A:
+            return CHIP8_OP_Fx0A;
+        case 0x15:
+            return CHIP8_OP_Fx15;
+        case 0x18:
+            return CHIP8_OP_Fx18;
+        case 0x1E:
+            return CHIP8_OP_Fx1E;
+        case 0x29:
+            return CHIP8_OP_Fx29;
+        case 0x33:
+            return CHIP8_OP_Fx33;
+        case 0x55:
+            return CHIP8_OP_Fx55;
+        case 0x65:
+            return CHIP8_OP_Fx65;
+        }
+        return CHIP8_OP_NULL;
+    }
+
+    return prefix[opcode >> 12u];
+}
+
+const char *chip8_op_name(enum chip8_op op)
+{
+    return op < CHIP8_OP_COUNT ? ops[op].name : "NULL";
+}
+
+unsigned int chip8_op_flags(enum chip8_op op)
+{
+    return op < CHIP8_OP_COUNT ? ops[op].flags : 0;
+}
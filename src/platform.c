@@ -1,6 +1,7 @@
 #include <SDL2/SDL.h>
 #include <stdint.h>
 
+#include "chip8.h"
 #include "platform.h"
 
 void platform_init(struct Platform *platform, char const *title, int window_width, int window_height, int texture_width,
@@ -13,6 +14,18 @@ void platform_init(struct Platform *platform, char const *title, int window_widt
     platform->renderer = SDL_CreateRenderer(platform->window, -1, SDL_RENDERER_ACCELERATED);
     platform->texture = SDL_CreateTexture(platform->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING,
                                           texture_width, texture_height);
+    platform->overlay = NULL;
+    platform->overlay_count = 0;
+
+    // initializing map of keypad with keyboard
+    for (uint8_t i = 0; i < 128; i++)
+    {
+        platform->keypad_map[i] = -1;
+    }
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        platform->keypad_map[CHIP8_KEYMAP[i]] = i;
+    }
 }
 
 void platform_destroy(struct Platform *platform)
@@ -30,9 +43,46 @@ void update_window(struct Platform *platform, void const *buffer, int pitch)
     SDL_UpdateTexture(platform->texture, NULL, buffer, pitch);
     SDL_RenderClear(platform->renderer);
     SDL_RenderCopy(platform->renderer, platform->texture, NULL, NULL);
+
+    if (platform->overlay)
+    {
+        int width, height;
+        SDL_GetRendererOutputSize(platform->renderer, &width, &height);
+
+        int bar_width = width / 2 / platform->overlay_count;
+        if (bar_width < 1)
+            bar_width = 1;
+
+        SDL_SetRenderDrawBlendMode(platform->renderer, SDL_BLENDMODE_BLEND);
+        for (int i = 0; i < platform->overlay_count; i++)
+        {
+            int bar_height = platform->overlay[i] * height / 4 / 128;
+            SDL_Rect bar = {i * bar_width, height - bar_height, bar_width, bar_height};
+
+            // red once a bar is over 128, ie. longer than one 60 Hz frame
+            if (platform->overlay[i] > 128)
+                SDL_SetRenderDrawColor(platform->renderer, 255, 64, 64, 192);
+            else
+                SDL_SetRenderDrawColor(platform->renderer, 64, 255, 64, 192);
+            SDL_RenderFillRect(platform->renderer, &bar);
+        }
+        SDL_SetRenderDrawColor(platform->renderer, 0, 0, 0, 255);
+    }
+
     SDL_RenderPresent(platform->renderer);
 }
 
+void platform_set_overlay(struct Platform *platform, uint8_t const *bars, int count)
+{
+    platform->overlay = bars;
+    platform->overlay_count = count;
+}
+
+void platform_set_title(struct Platform *platform, char const *title)
+{
+    SDL_SetWindowTitle(platform->window, title);
+}
+
 char process_input(struct Platform *platform, uint8_t *keys)
 {
     char quit = 0;
@@ -48,24 +98,24 @@ char process_input(struct Platform *platform, uint8_t *keys)
         }
         break;
         case SDL_KEYDOWN: {
-            uint8_t keycode = event.key.keysym.sym;
+            SDL_Keycode keycode = event.key.keysym.sym;
             if (keycode == SDLK_ESCAPE)
             {
                 quit = 1;
                 break;
             }
-            if (KEYPAD_MAP[keycode] != 255)
+            if (keycode >= 0 && keycode < 128 && platform->keypad_map[keycode] != 255)
             {
-                keys[KEYPAD_MAP[keycode]] = 1;
+                keys[platform->keypad_map[keycode]] = 1;
             }
         }
         break;
         case SDL_KEYUP: {
-            uint8_t keycode = event.key.keysym.sym;
+            SDL_Keycode keycode = event.key.keysym.sym;
 
-            if (KEYPAD_MAP[keycode] != 255)
+            if (keycode >= 0 && keycode < 128 && platform->keypad_map[keycode] != 255)
             {
-                keys[KEYPAD_MAP[keycode]] = 0;
+                keys[platform->keypad_map[keycode]] = 0;
             }
         }
         break;
@@ -0,0 +1,314 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "opcode.h"
+#include "profiler.h"
+
+#ifdef CHIP8_PROFILE
+
+#define REPORT_TOP 10
+
+struct Block
+{
+    uint16_t start;
+    uint16_t length;
+    uint64_t count;
+    uint64_t instructions;
+};
+
+struct Loop
+{
+    uint16_t start;
+    uint16_t end;
+    uint64_t iterations;
+    uint64_t instructions;
+};
+
+void chip8_profile_reset(struct Chip8Profile *profile, uint16_t entry)
+{
+    memset(profile, 0, sizeof(*profile));
+    profile->nodes[0] = (struct ProfileNode){entry, PROFILE_NO_NODE, PROFILE_NO_NODE, PROFILE_NO_NODE, 0, 1};
+    profile->node_count = 1;
+}
+
+// working space of one report, on the heap so reports for different chips can be written at the same time
+struct ReportScratch
+{
+    uint64_t pcs[4096][2];
+    struct Block blocks[2048];
+    struct Loop loops[2048];
+};
+
+static uint16_t opcode_at(struct Chip8 const *chip, unsigned int address)
+{
+    return (chip->memory[address & 0x0FFFu] << 8u) | chip->memory[(address + 1) & 0x0FFFu];
+}
+
+// instructions after which control doesnt simply fall through
+static int ends_block(uint16_t opcode)
+{
+    return (chip8_op_flags(chip8_decode(opcode)) & CHIP8_OPF_BRANCH) != 0;
+}
+
+static int compare_blocks(const void *a, const void *b)
+{
+    uint64_t x = ((struct Block const *)a)->instructions, y = ((struct Block const *)b)->instructions;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static int compare_loops(const void *a, const void *b)
+{
+    uint64_t x = ((struct Loop const *)a)->instructions, y = ((struct Loop const *)b)->instructions;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static int compare_counts(const void *a, const void *b)
+{
+    uint64_t x = ((uint64_t const *)a)[0], y = ((uint64_t const *)b)[0];
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// self plus every descendant
+static uint64_t inclusive(struct Chip8Profile const *profile, uint16_t node)
+{
+    uint64_t total = profile->nodes[node].self;
+
+    for (uint16_t child = profile->nodes[node].first_child; child != PROFILE_NO_NODE;
+         child = profile->nodes[child].next_sibling)
+    {
+        total += inclusive(profile, child);
+    }
+    return total;
+}
+
+// recursive calls are only counted once towards inclusive time
+static int has_ancestor(struct Chip8Profile const *profile, uint16_t node, uint16_t function)
+{
+    for (uint16_t parent = profile->nodes[node].parent; parent != PROFILE_NO_NODE;
+         parent = profile->nodes[parent].parent)
+    {
+        if (profile->nodes[parent].function == function)
+            return 1;
+    }
+    return 0;
+}
+
+static void write_tree(FILE *out, struct Chip8Profile const *profile, uint16_t node, int depth, uint64_t total)
+{
+    uint64_t incl = inclusive(profile, node);
+
+    fprintf(out, "%*s%03X  calls %llu  inclusive %llu (%.1f%%)  exclusive %llu\n", depth * 2, "",
+            profile->nodes[node].function, (unsigned long long)profile->nodes[node].calls, (unsigned long long)incl,
+            total ? 100.0 * incl / total : 0.0, (unsigned long long)profile->nodes[node].self);
+
+    for (uint16_t child = profile->nodes[node].first_child; child != PROFILE_NO_NODE;
+         child = profile->nodes[child].next_sibling)
+    {
+        write_tree(out, profile, child, depth + 1, total);
+    }
+}
+
+int chip8_profile_write_report(struct Chip8 const *chip, const char *filename)
+{
+    struct Chip8Profile const *profile = &chip->profile;
+
+    struct ReportScratch *scratch = malloc(sizeof(*scratch));
+    if (scratch == NULL)
+    {
+        return CHIP8_ERR_NO_MEMORY;
+    }
+
+    FILE *out = fopen(filename, "w");
+    if (out == NULL)
+    {
+        free(scratch);
+        return CHIP8_ERR_FILE;
+    }
+
+    uint64_t total = 0;
+    for (unsigned int pc = 0; pc < 4096; pc++)
+    {
+        total += profile->pc_counts[pc];
+    }
+    fprintf(out, "instructions %llu\n\n", (unsigned long long)total);
+
+    // opcode classes, merged over the bits the handler doesnt dispatch on
+    uint64_t classes[CHIP8_OP_COUNT][2] = {{0}};
+    for (unsigned int op = 0; op < CHIP8_OP_COUNT; op++)
+    {
+        classes[op][1] = op;
+    }
+    for (unsigned int prefix = 0; prefix < 16; prefix++)
+    {
+        for (unsigned int low = 0; low < 256; low++)
+        {
+            classes[chip8_decode((prefix << 12u) | low)][0] += profile->op_counts[prefix][low];
+        }
+    }
+    qsort(classes, CHIP8_OP_COUNT, sizeof(classes[0]), compare_counts);
+
+    fprintf(out, "opcode classes\n");
+    for (unsigned int i = 0; i < CHIP8_OP_COUNT && classes[i][0]; i++)
+    {
+        fprintf(out, "  %s  %12llu  %5.1f%%\n", chip8_op_name(classes[i][1]), (unsigned long long)classes[i][0],
+                100.0 * classes[i][0] / total);
+    }
+
+    // hot spots
+    uint64_t(*pcs)[2] = scratch->pcs;
+    unsigned int pc_count = 0;
+    for (unsigned int pc = 0; pc < 4096; pc++)
+    {
+        if (profile->pc_counts[pc])
+        {
+            pcs[pc_count][0] = profile->pc_counts[pc];
+            pcs[pc_count][1] = pc;
+            pc_count++;
+        }
+    }
+    qsort(pcs, pc_count, sizeof(pcs[0]), compare_counts);
+
+    fprintf(out, "\nhot pcs\n");
+    for (unsigned int i = 0; i < pc_count && i < REPORT_TOP; i++)
+    {
+        uint16_t opcode = opcode_at(chip, pcs[i][1]);
+        fprintf(out, "  %03X  %04X %s  %12llu  %5.1f%%\n", (unsigned int)pcs[i][1], opcode,
+                chip8_op_name(chip8_decode(opcode)), (unsigned long long)pcs[i][0], 100.0 * pcs[i][0] / total);
+    }
+
+    // basic blocks: runs of executed instructions with the same count, cut after control flow
+    struct Block *blocks = scratch->blocks;
+    unsigned int block_count = 0;
+    for (unsigned int pc = 0; pc + 1 < 4096; pc += 2)
+    {
+        uint64_t count = profile->pc_counts[pc];
+        if (count == 0)
+            continue;
+
+        struct Block *block = block_count ? &blocks[block_count - 1] : NULL;
+        if (block && block->start + block->length * 2u == pc && block->count == count &&
+            !ends_block(opcode_at(chip, pc - 2)))
+        {
+            block->length++;
+            block->instructions += count;
+        }
+        else
+        {
+            blocks[block_count++] = (struct Block){pc, 1, count, count};
+        }
+    }
+    qsort(blocks, block_count, sizeof(blocks[0]), compare_blocks);
+
+    fprintf(out, "\nhot blocks\n");
+    for (unsigned int i = 0; i < block_count && i < REPORT_TOP; i++)
+    {
+        fprintf(out, "  %03X-%03X  %2u instructions  entered %12llu  %5.1f%%\n", blocks[i].start,
+                blocks[i].start + blocks[i].length * 2 - 2, blocks[i].length, (unsigned long long)blocks[i].count,
+                100.0 * blocks[i].instructions / total);
+    }
+
+    // loops: executed backward jumps
+    struct Loop *loops = scratch->loops;
+    unsigned int loop_count = 0;
+    for (unsigned int pc = 0; pc + 1 < 4096 && loop_count < 2048; pc++)
+    {
+        uint16_t opcode = opcode_at(chip, pc);
+        if (profile->pc_counts[pc] == 0 || (opcode & 0xF000u) != 0x1000u || (opcode & 0x0FFFu) > pc)
+            continue;
+
+        struct Loop loop = {opcode & 0x0FFFu, pc, profile->pc_counts[pc], 0};
+        for (unsigned int i = loop.start; i <= loop.end; i++)
+        {
+            loop.instructions += profile->pc_counts[i];
+        }
+        loops[loop_count++] = loop;
+    }
+    qsort(loops, loop_count, sizeof(loops[0]), compare_loops);
+
+    fprintf(out, "\nhot loops\n");
+    for (unsigned int i = 0; i < loop_count && i < REPORT_TOP; i++)
+    {
+        fprintf(out, "  %03X-%03X  iterations %12llu  %5.1f%%\n", loops[i].start, loops[i].end,
+                (unsigned long long)loops[i].iterations, 100.0 * loops[i].instructions / total);
+    }
+
+    // functions, merged over every call path
+    fprintf(out, "\nfunctions\n");
+    for (unsigned int function = 0; function < 4096; function++)
+    {
+        uint64_t calls = 0, self = 0, incl = 0;
+        char seen = 0;
+
+        for (uint16_t node = 0; node < profile->node_count; node++)
+        {
+            if (profile->nodes[node].function != function)
+                continue;
+
+            seen = 1;
+            calls += profile->nodes[node].calls;
+            self += profile->nodes[node].self;
+            if (!has_ancestor(profile, node, function))
+                incl += inclusive(profile, node);
+        }
+
+        if (seen)
+        {
+            fprintf(out, "  %03X  calls %10llu  inclusive %12llu (%5.1f%%)  exclusive %12llu (%5.1f%%)\n", function,
+                    (unsigned long long)calls, (unsigned long long)incl, 100.0 * incl / total,
+                    (unsigned long long)self, 100.0 * self / total);
+        }
+    }
+
+    fprintf(out, "\ncall tree\n");
+    write_tree(out, profile, 0, 1, total);
+    if (profile->lost_calls)
+    {
+        fprintf(out, "  (%llu calls not recorded, tree full)\n", (unsigned long long)profile->lost_calls);
+    }
+
+    int error = ferror(out);
+    fclose(out);
+    free(scratch);
+    return error ? CHIP8_ERR_FILE : CHIP8_OK;
+}
+
+int chip8_profile_write_folded(struct Chip8 const *chip, const char *filename)
+{
+    struct Chip8Profile const *profile = &chip->profile;
+
+    FILE *out = fopen(filename, "w");
+    if (out == NULL)
+    {
+        return CHIP8_ERR_FILE;
+    }
+
+    for (uint16_t node = 0; node < profile->node_count; node++)
+    {
+        if (profile->nodes[node].self == 0)
+            continue;
+
+        // walk up to the root, then print the path root first
+        uint16_t path[PROFILE_MAX_NODES];
+        unsigned int depth = 0;
+        for (uint16_t n = node; n != PROFILE_NO_NODE; n = profile->nodes[n].parent)
+        {
+            path[depth++] = profile->nodes[n].function;
+        }
+
+        while (depth > 0)
+        {
+            depth--;
+            fprintf(out, "0x%03X%s", path[depth], depth > 0 ? ";" : "");
+        }
+        fprintf(out, " %llu\n", (unsigned long long)profile->nodes[node].self);
+    }
+
+    int error = ferror(out);
+    fclose(out);
+    return error ? CHIP8_ERR_FILE : CHIP8_OK;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "shm_export.h"
+
+int shm_export_open(struct ShmExport *shm, const char *name)
+{
+    shm->frame = NULL;
+    snprintf(shm->name, sizeof(shm->name), "%s", name);
+
+    int fd = shm_open(shm->name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        return CHIP8_ERR_SHARED_MEMORY;
+    }
+
+    if (ftruncate(fd, sizeof(struct Chip8SharedFrame)) < 0)
+    {
+        close(fd);
+        shm_unlink(shm->name);
+        return CHIP8_ERR_SHARED_MEMORY;
+    }
+
+    void *mapping = mmap(NULL, sizeof(struct Chip8SharedFrame), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // the mapping stays valid after closing the descriptor
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        shm_unlink(shm->name);
+        return CHIP8_ERR_SHARED_MEMORY;
+    }
+
+    shm->frame = mapping;
+    memset(shm->frame, 0, sizeof(*shm->frame));
+    shm->frame->version = CHIP8_SHM_VERSION;
+    shm->frame->width = VIDEO_WIDTH;
+    shm->frame->height = VIDEO_HEIGHT;
+    // written last so readers only accept a fully initialised header
+    __atomic_store_n(&shm->frame->magic, CHIP8_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    return CHIP8_OK;
+}
+
+void shm_export_publish(struct ShmExport *shm, struct Chip8 const *chip)
+{
+    struct Chip8SharedFrame *frame = shm->frame;
+    uint32_t sequence = frame->sequence;
+
+    // odd: copy in progress
+    __atomic_store_n(&frame->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    frame->frame++;
+    memcpy(frame->registers, chip->registers, sizeof(frame->registers));
+    frame->index = chip->index;
+    frame->pc = chip->pc;
+    frame->sp = chip->sp;
+    frame->delay_timer = chip->delay_timer;
+    frame->sound_timer = chip->sound_timer;
+    // duplicate frames are already in the segment
+    if (frame->digest != chip->video_digest || frame->frame == 1)
+    {
+        frame->digest = chip->video_digest;
+        memcpy(frame->video, chip->video, sizeof(frame->video));
+    }
+
+    __atomic_store_n(&frame->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+void shm_export_close(struct ShmExport *shm)
+{
+    if (shm->frame == NULL)
+    {
+        return;
+    }
+
+    munmap(shm->frame, sizeof(*shm->frame));
+    shm_unlink(shm->name);
+    shm->frame = NULL;
+}
+
+void shm_export_read(struct Chip8SharedFrame const *frame, struct Chip8SharedFrame *out)
+{
+    while (1)
+    {
+        uint32_t before = __atomic_load_n(&frame->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1u)
+        {
+            continue;
+        }
+
+        memcpy(out, frame, sizeof(*out));
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&frame->sequence, __ATOMIC_RELAXED) == before)
+        {
+            out->sequence = before;
+            return;
+        }
+    }
+}
@@ -0,0 +1,265 @@
+// check: consistency checks for the interpreter core
+//
+// usage: check rom.ch8 [--batches N] [--seed N]
+//
+// runs the rom twice with the same random key presses, once through chip8_run() in batches of random size and
+// once through chip8_cycle(), and fails as soon as the machine states differ. after every batch the frame digest
+// and the per-row bits are recomputed from `video`, also on copies taken with chip8_copy_state().
+//
+// built with -DCHIP8_AOT and the output of chip8rc for the same rom (see `make check`), it also runs the rom through
+// chip8_aot_execute() with every budget up to MAX_BATCH, so the fallback after the rom writes over its translated
+// code is hit at every position inside a batch.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+
+#ifdef CHIP8_AOT
+#include "aot.h"
+
+// batches per budget in the translated run
+#define AOT_BATCHES 2048u
+#endif
+
+// longest batch handed to chip8_run(), long enough for every superinstruction
+#define MAX_BATCH 32u
+
+struct Options
+{
+    const char *rom_filename;
+    unsigned long batches;
+    uint32_t seed;
+};
+
+static uint32_t next_random(uint32_t *state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return *state >> 8u;
+}
+
+// returns 0 and names the first mismatch when `video_rows` or `video_digest` dont match `video`
+static int check_digest(struct Chip8 const *chip, const char **what)
+{
+    uint64_t digest = 0;
+
+    for (unsigned int row = 0; row < 32; row++)
+    {
+        uint64_t bits = 0;
+        for (unsigned int x = 0; x < 64; x++)
+        {
+            if (chip->video[row * 64 + x])
+                bits |= 1ull << (63u - x);
+        }
+        if (bits != chip->video_rows[row])
+        {
+            *what = "video_rows";
+            return 0;
+        }
+        digest ^= chip8_row_hash(bits, row);
+    }
+
+    if (digest != chip->video_digest || digest != chip8_frame_digest(chip))
+    {
+        *what = "video_digest";
+        return 0;
+    }
+
+    return 1;
+}
+
+#ifdef CHIP8_AOT
+// the translated code never stores `opcode`, everything else has to match
+static int same_state(struct Chip8 const *a, struct Chip8 const *b)
+{
+    return memcmp(a, b, offsetof(struct Chip8, opcode)) == 0 && a->rng == b->rng;
+}
+
+// returns the number of budgets the rom modified its translated code in
+static unsigned int check_aot(struct Options const *options, struct Chip8 *translated, struct Chip8 *stepped)
+{
+    unsigned int modified = 0;
+
+    for (unsigned int budget = 1; budget <= MAX_BATCH; budget++)
+    {
+        memset(translated, 0, sizeof(struct Chip8));
+        memset(stepped, 0, sizeof(struct Chip8));
+        chip8_init(translated);
+        chip8_init(stepped);
+        chip8_seed(translated, options->seed);
+        chip8_seed(stepped, options->seed);
+        chip8_load_rom(translated, options->rom_filename);
+        chip8_load_rom(stepped, options->rom_filename);
+
+        uint32_t random = options->seed;
+        uint64_t instructions = 0;
+        char disabled = !chip8_aot_intact(translated);
+        if (disabled)
+        {
+            printf("%s: not the rom the translated code was made from\n", options->rom_filename);
+            exit(-1);
+        }
+
+        for (unsigned int batch = 0; batch < AOT_BATCHES; batch++)
+        {
+            if (batch % 64 == 0)
+            {
+                unsigned int key = next_random(&random) % 17;
+                for (uint8_t i = 0; i < 16; i++)
+                {
+                    translated->keypad[i] = stepped->keypad[i] = i == key;
+                }
+            }
+
+            chip8_aot_execute(translated, budget, &disabled);
+            for (unsigned int i = 0; i < budget; i++)
+            {
+                chip8_cycle(stepped);
+            }
+            instructions += budget;
+
+            if (!same_state(translated, stepped))
+            {
+                printf("%s: chip8_aot_execute() and chip8_cycle() differ after %llu instructions (budget %u, pc %03X "
+                       "vs %03X)\n",
+                       options->rom_filename, (unsigned long long)instructions, budget, translated->pc, stepped->pc);
+                exit(-1);
+            }
+        }
+
+        modified += disabled;
+    }
+
+    return modified;
+}
+#endif
+
+static int parse_options(int argc, char **argv, struct Options *options)
+{
+    if (argc < 2)
+        return 0;
+
+    options->rom_filename = argv[1];
+    options->batches = 200000;
+    options->seed = 1;
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            return 0;
+
+        if (strcmp(argv[i], "--batches") == 0)
+            options->batches = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--seed") == 0)
+            options->seed = strtoul(argv[++i], NULL, 10);
+        else
+            return 0;
+    }
+
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    struct Options options;
+
+    if (!parse_options(argc, argv, &options))
+    {
+        printf("args required: rom [--batches N] [--seed N]\n");
+        exit(-1);
+    }
+
+    // zeroed so padding inside the state compares equal
+    struct Chip8 *batched = calloc(1, sizeof(struct Chip8));
+    struct Chip8 *stepped = calloc(1, sizeof(struct Chip8));
+    struct Chip8 *copy = calloc(1, sizeof(struct Chip8));
+    if (batched == NULL || stepped == NULL || copy == NULL)
+    {
+        printf("%s\n", chip8_error_string(CHIP8_ERR_NO_MEMORY));
+        exit(-1);
+    }
+
+    chip8_init(batched);
+    chip8_init(stepped);
+    chip8_init(copy);
+    chip8_seed(batched, options.seed);
+    chip8_seed(stepped, options.seed);
+
+    int error = chip8_load_rom(batched, options.rom_filename);
+    if (error == CHIP8_OK)
+        error = chip8_load_rom(stepped, options.rom_filename);
+    if (error != CHIP8_OK)
+    {
+        printf("%s: %s\n", options.rom_filename, chip8_error_string(error));
+        exit(-1);
+    }
+
+    uint32_t random = options.seed;
+    uint64_t instructions = 0;
+    const char *what = NULL;
+
+    for (unsigned long batch = 0; batch < options.batches; batch++)
+    {
+        unsigned int count = 1 + next_random(&random) % MAX_BATCH;
+
+        // hold a different key (or none) now and then
+        if (batch % 64 == 0)
+        {
+            unsigned int key = next_random(&random) % 17;
+            for (uint8_t i = 0; i < 16; i++)
+            {
+                batched->keypad[i] = stepped->keypad[i] = i == key;
+            }
+        }
+
+        chip8_run(batched, count);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            chip8_cycle(stepped);
+        }
+        instructions += count;
+
+        if (memcmp(batched, stepped, offsetof(struct Chip8, table)) != 0)
+        {
+            printf("%s: chip8_run() and chip8_cycle() differ after %llu instructions (batch %lu, pc %03X vs %03X)\n",
+                   options.rom_filename, (unsigned long long)instructions, batch, batched->pc, stepped->pc);
+            exit(-1);
+        }
+
+        if (!check_digest(batched, &what))
+        {
+            printf("%s: %s out of step with video after %llu instructions\n", options.rom_filename, what,
+                   (unsigned long long)instructions);
+            exit(-1);
+        }
+
+        if (batch % 1024 == 0)
+        {
+            chip8_copy_state(copy, batched);
+            if (!check_digest(copy, &what))
+            {
+                printf("%s: %s out of step with video in a copy after %llu instructions\n", options.rom_filename,
+                       what, (unsigned long long)instructions);
+                exit(-1);
+            }
+        }
+    }
+
+    printf("%s: ok, %llu instructions in %lu batches\n", options.rom_filename, (unsigned long long)instructions,
+           options.batches);
+    chip8_fusion_report(batched, stdout);
+
+#ifdef CHIP8_AOT
+    unsigned int modified = check_aot(&options, batched, stepped);
+    printf("%s: aot ok, budgets 1 to %u, translated code modified in %u of them\n", options.rom_filename, MAX_BATCH,
+           modified);
+#endif
+
+    free(copy);
+    free(stepped);
+    free(batched);
+    return 0;
+}
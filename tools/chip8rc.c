@@ -0,0 +1,396 @@
+// chip8rc: ahead-of-time recompiler
+// translates a rom into a C file implementing chip8_aot_run() (see include/aot.h)
+//
+// usage: chip8rc rom.ch8 out.c
+//
+// control flow is recovered by following 1nnn, 2nnn, 00EE return sites and skips from the start address.
+// anything that cannot be resolved statically (Bnnn, 00EE, code written at runtime) goes through a
+// switch on pc, and addresses missing from it are left to the interpreter
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opcode.h"
+
+// must match src/chip8.c
+#define ROM_START 0x200u
+#define MEMORY_SIZE 4096u
+
+enum ins_kind
+{
+    // cannot be translated, left to the interpreter
+    INS_INVALID,
+    // falls through to the next instruction
+    INS_PLAIN,
+    // falls through, but may overwrite translated code
+    INS_WRITE,
+    INS_JUMP,
+    INS_CALL,
+    // target only known at runtime
+    INS_INDIRECT,
+    INS_SKIP,
+    // Fx0A, repeats itself until a key is pressed
+    INS_WAIT
+};
+
+struct Ins
+{
+    enum ins_kind kind;
+    enum chip8_op op;
+};
+
+struct Rom
+{
+    uint8_t memory[MEMORY_SIZE];
+    unsigned int end;
+
+    // instruction starts reached while following control flow
+    // padded so successors of the last instructions can be marked
+    uint8_t translated[MEMORY_SIZE + 4];
+    // first instruction of a basic block
+    uint8_t leader[MEMORY_SIZE + 4];
+    // bytes belonging to a translated instruction
+    uint8_t code[MEMORY_SIZE + 4];
+};
+
+// classified by the same decoder the interpreter builds its dispatch tables from
+static struct Ins decode(uint16_t opcode)
+{
+    struct Ins ins = {INS_PLAIN, chip8_decode(opcode)};
+    unsigned int flags = chip8_op_flags(ins.op);
+
+    // end of rom marker, chip8_cycle() keeps pc on it
+    if (opcode == 0xFEEFu)
+        ins.kind = INS_INVALID;
+    else if (flags & CHIP8_OPF_JUMP)
+        ins.kind = INS_JUMP;
+    else if (flags & CHIP8_OPF_CALL)
+        ins.kind = INS_CALL;
+    else if (flags & (CHIP8_OPF_RETURN | CHIP8_OPF_INDIRECT))
+        ins.kind = INS_INDIRECT;
+    else if (flags & CHIP8_OPF_SKIP)
+        ins.kind = INS_SKIP;
+    else if (flags & CHIP8_OPF_WAIT)
+        ins.kind = INS_WAIT;
+    else if (flags & CHIP8_OPF_WRITE)
+        ins.kind = INS_WRITE;
+
+    return ins;
+}
+
+static uint16_t fetch(struct Rom const *rom, unsigned int address)
+{
+    return (rom->memory[address] << 8u) | rom->memory[address + 1];
+}
+
+// both bytes of the instruction have to come from the rom image
+static int in_rom(struct Rom const *rom, unsigned int address)
+{
+    return address >= ROM_START && address + 1 < rom->end;
+}
+
+static void discover(struct Rom *rom)
+{
+    static uint16_t worklist[MEMORY_SIZE * 2];
+    unsigned int top = 0;
+
+    worklist[top++] = ROM_START;
+    rom->leader[ROM_START] = 1;
+
+    while (top > 0)
+    {
+        unsigned int address = worklist[--top];
+
+        if (!in_rom(rom, address) || rom->translated[address])
+            continue;
+
+        uint16_t opcode = fetch(rom, address);
+        struct Ins ins = decode(opcode);
+        if (ins.kind == INS_INVALID)
+            continue;
+
+        rom->translated[address] = 1;
+        rom->code[address] = 1;
+        rom->code[address + 1] = 1;
+
+        unsigned int next = address + 2;
+        unsigned int target = opcode & 0x0FFFu;
+
+        switch (ins.kind)
+        {
+        case INS_PLAIN:
+        case INS_WRITE:
+            worklist[top++] = next;
+            break;
+        case INS_JUMP:
+            rom->leader[target] = 1;
+            worklist[top++] = target;
+            break;
+        case INS_CALL:
+            // the return site is reached through 00EE
+            rom->leader[target] = 1;
+            rom->leader[next] = 1;
+            worklist[top++] = target;
+            worklist[top++] = next;
+            break;
+        case INS_SKIP:
+            rom->leader[next] = 1;
+            rom->leader[next + 2] = 1;
+            worklist[top++] = next;
+            worklist[top++] = next + 2;
+            break;
+        case INS_WAIT:
+            rom->leader[address] = 1;
+            rom->leader[next] = 1;
+            worklist[top++] = next;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void emit_goto(FILE *out, struct Rom const *rom, unsigned int address)
+{
+    if (address < MEMORY_SIZE && rom->translated[address])
+        fprintf(out, "goto L_%03X;\n", address);
+    else
+        fprintf(out, "{ chip->pc = 0x%03X; goto dispatch; }\n", address);
+}
+
+static void emit_bytes(FILE *out, const char *name, uint8_t const *bytes, unsigned int size)
+{
+    fprintf(out, "static const uint8_t %s[ROM_SIZE] = {", name);
+    for (unsigned int i = 0; i < size; i++)
+    {
+        fprintf(out, "%s0x%02X,", i % 16 ? " " : "\n    ", bytes[i]);
+    }
+    fprintf(out, "\n};\n\n");
+}
+
+static void emit_instruction(FILE *out, struct Rom const *rom, unsigned int address)
+{
+    uint16_t opcode = fetch(rom, address);
+    struct Ins ins = decode(opcode);
+
+    unsigned int next = address + 2;
+    unsigned int x = (opcode & 0x0F00u) >> 8u;
+    unsigned int y = (opcode & 0x00F0u) >> 4u;
+    unsigned int byte = opcode & 0x00FFu;
+    unsigned int target = opcode & 0x0FFFu;
+
+    fprintf(out, "L_%03X:\n", address);
+    fprintf(out, "    STEP(0x%03X);\n", address);
+
+    switch (opcode >> 12u)
+    {
+    // simple register ops are written out so the compiler can keep them in registers
+    case 0x1:
+        fprintf(out, "    TICK(chip);\n    ");
+        emit_goto(out, rom, target);
+        return;
+    case 0x3:
+    case 0x4:
+    case 0x5:
+    case 0x9:
+        // ticking first is fine, the timers dont take part in the comparison
+        fprintf(out, "    TICK(chip);\n");
+        if ((opcode >> 12u) == 0x3)
+            fprintf(out, "    if (chip->registers[%u] == 0x%02X)\n        ", x, byte);
+        else if ((opcode >> 12u) == 0x4)
+            fprintf(out, "    if (chip->registers[%u] != 0x%02X)\n        ", x, byte);
+        else if ((opcode >> 12u) == 0x5)
+            fprintf(out, "    if (chip->registers[%u] == chip->registers[%u])\n        ", x, y);
+        else
+            fprintf(out, "    if (chip->registers[%u] != chip->registers[%u])\n        ", x, y);
+        emit_goto(out, rom, next + 2);
+        break;
+    case 0x6:
+        fprintf(out, "    chip->registers[%u] = 0x%02X;\n    TICK(chip);\n", x, byte);
+        break;
+    case 0x7:
+        fprintf(out, "    chip->registers[%u] += 0x%02X;\n    TICK(chip);\n", x, byte);
+        break;
+    case 0xA:
+        fprintf(out, "    chip->index = 0x%03X;\n    TICK(chip);\n", target);
+        break;
+    default:
+        if ((opcode >> 12u) == 0x8 && (opcode & 0x000Fu) <= 0x3)
+        {
+            static const char *ops[4] = {"=", "|=", "&=", "^="};
+            fprintf(out, "    chip->registers[%u] %s chip->registers[%u];\n    TICK(chip);\n", x,
+                    ops[opcode & 0x000Fu], y);
+            break;
+        }
+
+        // everything else goes through the interpreter's handlers, with pc set for the ones that use it
+        if (ins.kind == INS_CALL || ins.kind == INS_SKIP || ins.kind == INS_WAIT)
+            fprintf(out, "    chip->pc = 0x%03X;\n", next);
+        fprintf(out, "    chip->opcode = 0x%04X;\n    OP_%s(chip);\n    TICK(chip);\n", opcode,
+                chip8_op_name(ins.op));
+
+        switch (ins.kind)
+        {
+        case INS_CALL:
+            fprintf(out, "    ");
+            emit_goto(out, rom, target);
+            return;
+        case INS_INDIRECT:
+            fprintf(out, "    goto dispatch;\n");
+            return;
+        case INS_SKIP:
+            fprintf(out, "    if (chip->pc != 0x%03X)\n        ", next);
+            emit_goto(out, rom, next + 2);
+            break;
+        case INS_WAIT:
+            fprintf(out, "    if (chip->pc != 0x%03X)\n        ", next);
+            emit_goto(out, rom, address);
+            break;
+        case INS_WRITE:
+            // Fx33 writes 3 bytes, Fx55 at most x + 1
+            fprintf(out, "    if (overwrote(chip, chip->index, %u))\n", (opcode & 0x00FFu) == 0x33 ? 3 : x + 1);
+            fprintf(out, "    {\n        chip->pc = 0x%03X;\n", next);
+            fprintf(out, "        status = CHIP8_AOT_MODIFIED;\n        goto done;\n    }\n");
+            break;
+        default:
+            break;
+        }
+    }
+
+    // fall through when the next instruction is emitted right after this one
+    // (an instruction decoded at address + 1 would sit in between)
+    if (!rom->translated[next] || rom->translated[address + 1])
+    {
+        fprintf(out, "    ");
+        emit_goto(out, rom, next);
+    }
+}
+
+static void emit(FILE *out, struct Rom const *rom, const char *rom_filename)
+{
+    unsigned int size = rom->end - ROM_START;
+
+    fprintf(out, "// generated by tools/chip8rc.c from %s, do not edit\n\n", rom_filename);
+    fprintf(out, "#include <stdint.h>\n\n#include \"aot.h\"\n\n");
+    fprintf(out, "#define ROM_SIZE %u\n\n", size);
+
+    emit_bytes(out, "rom_image", &rom->memory[ROM_START], size);
+    emit_bytes(out, "code_map", &rom->code[ROM_START], size);
+
+    fprintf(out, "// checks whether a write changed any translated byte\n"
+                 "static int overwrote(struct Chip8 const *chip, unsigned int address, unsigned int length)\n"
+                 "{\n"
+                 "    for (unsigned int j = address; j < address + length; j++)\n"
+                 "    {\n"
+                 "        // the handlers wrap around memory\n"
+                 "        unsigned int i = j & 0x0FFFu;\n"
+                 "        if (i >= 0x%03X && i - 0x%03X < ROM_SIZE && code_map[i - 0x%03X] &&\n"
+                 "            chip->memory[i] != rom_image[i - 0x%03X])\n"
+                 "            return 1;\n"
+                 "    }\n"
+                 "    return 0;\n"
+                 "}\n\n",
+            ROM_START, ROM_START, ROM_START, ROM_START);
+
+    fprintf(out, "int chip8_aot_intact(struct Chip8 const *chip)\n"
+                 "{\n"
+                 "    return !overwrote(chip, 0x%03X, ROM_SIZE);\n"
+                 "}\n\n",
+            ROM_START);
+
+    fprintf(out, "// same order as chip8_cycle(): execute, then tick the timers\n"
+                 "#define TICK(chip)                                                                      \\\n"
+                 "    do                                                                                  \\\n"
+                 "    {                                                                                   \\\n"
+                 "        if ((chip)->delay_timer > 0)                                                    \\\n"
+                 "            (chip)->delay_timer--;                                                      \\\n"
+                 "        if ((chip)->sound_timer > 0)                                                    \\\n"
+                 "            (chip)->sound_timer--;                                                      \\\n"
+                 "    } while (0)\n\n"
+                 "// stops before the instruction at `address` once the budget is spent\n"
+                 "#define STEP(address)                                                                   \\\n"
+                 "    do                                                                                  \\\n"
+                 "    {                                                                                   \\\n"
+                 "        if (n == cycles)                                                                \\\n"
+                 "        {                                                                               \\\n"
+                 "            chip->pc = (address);                                                       \\\n"
+                 "            goto done;                                                                  \\\n"
+                 "        }                                                                               \\\n"
+                 "        n++;                                                                            \\\n"
+                 "    } while (0)\n\n");
+
+    fprintf(out, "enum chip8_aot_status chip8_aot_run(struct Chip8 *chip, unsigned int cycles, unsigned int *executed)\n"
+                 "{\n"
+                 "    enum chip8_aot_status status = CHIP8_AOT_OK;\n"
+                 "    unsigned int n = 0;\n\n"
+                 "dispatch: __attribute__((unused));\n"
+                 "    switch (chip->pc)\n"
+                 "    {\n");
+    for (unsigned int address = ROM_START; address < rom->end; address++)
+    {
+        if (rom->translated[address])
+            fprintf(out, "    case 0x%03X:\n        goto L_%03X;\n", address, address);
+    }
+    fprintf(out, "    default:\n"
+                 "        if (n < cycles)\n"
+                 "            status = CHIP8_AOT_MISS;\n"
+                 "        goto done;\n"
+                 "    }\n\n");
+
+    for (unsigned int address = ROM_START; address < rom->end; address++)
+    {
+        if (!rom->translated[address])
+            continue;
+        if (rom->leader[address])
+            fprintf(out, "    // block 0x%03X\n", address);
+        emit_instruction(out, rom, address);
+    }
+
+    fprintf(out, "\ndone:\n"
+                 "    *executed = n;\n"
+                 "    return status;\n"
+                 "}\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        printf("args required: rom, output\n");
+        exit(-1);
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (file == NULL)
+    {
+        printf("couldnt open %s\n", argv[1]);
+        exit(-1);
+    }
+
+    static struct Rom rom;
+    size_t size = fread(&rom.memory[ROM_START], 1, MEMORY_SIZE - ROM_START, file);
+    fclose(file);
+    rom.end = ROM_START + size;
+
+    discover(&rom);
+
+    FILE *out = fopen(argv[2], "w");
+    if (out == NULL)
+    {
+        printf("couldnt open %s\n", argv[2]);
+        exit(-1);
+    }
+    emit(out, &rom, argv[1]);
+    fclose(out);
+
+    unsigned int count = 0;
+    for (unsigned int address = ROM_START; address < rom.end; address++)
+    {
+        count += rom.translated[address];
+    }
+    printf("translated %u instructions from %s\n", count, argv[1]);
+
+    return 0;
+}
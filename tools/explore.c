@@ -0,0 +1,406 @@
+// explore: breadth-first search over the keypad inputs of a rom
+//
+// usage: explore rom.ch8 [--depth N] [--threads N] [--keys 0123456789ABCDEF] [--frontier N] [--cycles N]
+//                        [--coverage FILE]
+//
+// every state of a level is forked once per input (no key, or one of the configured keys held down) and run
+// for one frame. forks land in a shared set of state hashes and only states not seen before are expanded on
+// the next level. prints novel states/sec and how many distinct pcs were executed.
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chip8.h"
+#include "libchip8.h"
+
+struct Options
+{
+    const char *rom_filename;
+    const char *coverage_filename;
+    unsigned int depth;
+    unsigned int threads;
+    unsigned int cycles;
+    // states kept for expansion on the next level
+    size_t frontier;
+    // bit n set when key n is explored
+    uint16_t keys;
+};
+
+// visited set, open addressing over state hashes shared by all workers
+// 0 marks an empty slot
+struct Visited
+{
+    uint64_t *slots;
+    uint64_t mask;
+};
+
+struct Explorer;
+
+struct Worker
+{
+    pthread_t thread;
+    struct Explorer *explorer;
+
+    uint64_t frames;
+    uint64_t novel;
+    uint64_t dropped;
+    // novel states that could not be recorded because the visited set was full
+    uint64_t unrecorded;
+    uint8_t coverage[4096];
+
+    struct Chip8 work;
+};
+
+struct Explorer
+{
+    struct Options options;
+    struct Visited visited;
+
+    struct Chip8 *frontier;
+    size_t frontier_count;
+    // next frontier index to be claimed by a worker
+    size_t cursor;
+
+    // states kept for the next level, slots are claimed through `next_count` by all workers
+    struct Chip8 *next;
+    size_t next_count;
+    size_t next_capacity;
+
+    uint16_t inputs[17];
+    unsigned int input_count;
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t hash_bytes(uint64_t hash, void const *data, size_t size)
+{
+    uint8_t const *bytes = data;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+// covers everything that decides future behaviour, the keypad is overwritten by the next input anyway
+static uint64_t hash_state(struct Chip8 const *chip)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    uint32_t small[] = {chip->index, chip->pc, chip->sp, chip->delay_timer, chip->sound_timer, chip->rng};
+
+    hash = hash_bytes(hash, chip->registers, sizeof(chip->registers));
+    hash = hash_bytes(hash, small, sizeof(small));
+    hash = hash_bytes(hash, chip->stack, sizeof(chip->stack));
+    hash = hash_bytes(hash, chip->memory, sizeof(chip->memory));
+    // the frame digest stands in for the 8 KB of video
+    hash = hash_bytes(hash, &chip->video_digest, sizeof(chip->video_digest));
+
+    return hash;
+}
+
+// returns 1 when the hash was not in the set yet, -1 when it wasnt but the set is full
+static int visited_insert(struct Visited *visited, uint64_t hash)
+{
+    if (hash == 0)
+        hash = 1;
+
+    uint64_t slot = hash & visited->mask;
+    for (uint64_t probes = 0; probes <= visited->mask; probes++, slot = (slot + 1) & visited->mask)
+    {
+        uint64_t current = __atomic_load_n(&visited->slots[slot], __ATOMIC_RELAXED);
+
+        if (current == hash)
+            return 0;
+        if (current == 0)
+        {
+            if (__atomic_compare_exchange_n(&visited->slots[slot], &current, hash, 0, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED))
+                return 1;
+            // lost the race, `current` now holds the winner
+            if (current == hash)
+                return 0;
+        }
+    }
+
+    return -1;
+}
+
+static void run_frame(struct Worker *worker, struct Chip8 *chip, unsigned int cycles)
+{
+    for (unsigned int i = 0; i < cycles; i++)
+    {
+        worker->coverage[chip->pc & 0x0FFFu] = 1;
+        chip8_cycle(chip);
+    }
+    worker->frames++;
+}
+
+static void *worker_run(void *arg)
+{
+    struct Worker *worker = arg;
+    struct Explorer *explorer = worker->explorer;
+    const size_t chunk = 16;
+
+    while (1)
+    {
+        size_t start = __atomic_fetch_add(&explorer->cursor, chunk, __ATOMIC_RELAXED);
+        if (start >= explorer->frontier_count)
+            break;
+
+        size_t end = start + chunk < explorer->frontier_count ? start + chunk : explorer->frontier_count;
+
+        for (size_t i = start; i < end; i++)
+        {
+            for (unsigned int k = 0; k < explorer->input_count; k++)
+            {
+                // fork
+                chip8_copy_state(&worker->work, &explorer->frontier[i]);
+                for (uint8_t key = 0; key < 16; key++)
+                {
+                    worker->work.keypad[key] = (explorer->inputs[k] >> key) & 1u;
+                }
+
+                run_frame(worker, &worker->work, explorer->options.cycles);
+
+                int inserted = visited_insert(&explorer->visited, hash_state(&worker->work));
+                if (inserted == 0)
+                    continue;
+                // without room in the set this may be a duplicate, expand it anyway and report it
+                if (inserted < 0)
+                    worker->unrecorded++;
+
+                worker->novel++;
+                size_t slot = __atomic_fetch_add(&explorer->next_count, 1, __ATOMIC_RELAXED);
+                if (slot < explorer->next_capacity)
+                    chip8_copy_state(&explorer->next[slot], &worker->work);
+                else
+                    worker->dropped++;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int parse_options(int argc, char **argv, struct Options *options)
+{
+    if (argc < 2)
+        return 0;
+
+    options->rom_filename = argv[1];
+    options->coverage_filename = NULL;
+    options->depth = 8;
+    options->threads = 4;
+    options->cycles = CHIP8_CYCLES_PER_FRAME;
+    options->frontier = 20000;
+    options->keys = 0xFFFFu;
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            return 0;
+
+        if (strcmp(argv[i], "--depth") == 0)
+            options->depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0)
+            options->threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cycles") == 0)
+            options->cycles = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frontier") == 0)
+            options->frontier = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--coverage") == 0)
+            options->coverage_filename = argv[++i];
+        else if (strcmp(argv[i], "--keys") == 0)
+        {
+            options->keys = 0;
+            for (const char *c = argv[++i]; *c; c++)
+            {
+                char digit[2] = {*c, 0};
+                options->keys |= 1u << (strtoul(digit, NULL, 16) & 0xFu);
+            }
+        }
+        else
+            return 0;
+    }
+
+    return options->threads > 0 && options->frontier > 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct Explorer explorer;
+
+    if (!parse_options(argc, argv, &explorer.options))
+    {
+        printf("args required: rom [--depth N] [--threads N] [--keys 0123456789ABCDEF] [--frontier N] [--cycles N] "
+               "[--coverage FILE]\n");
+        exit(-1);
+    }
+
+    struct Options const *options = &explorer.options;
+
+    struct Chip8 *root = malloc(sizeof(*root));
+    chip8_init(root);
+    int error = chip8_load_rom(root, options->rom_filename);
+    if (error != CHIP8_OK)
+    {
+        printf("%s: %s\n", options->rom_filename, chip8_error_string(error));
+        exit(-1);
+    }
+
+    // inputs: nothing held, then each configured key on its own
+    explorer.input_count = 0;
+    explorer.inputs[explorer.input_count++] = 0;
+    for (uint8_t key = 0; key < 16; key++)
+    {
+        if ((options->keys >> key) & 1u)
+            explorer.inputs[explorer.input_count++] = 1u << key;
+    }
+
+    // room for every state of a full frontier expanded once, rounded up to a power of two and half empty
+    uint64_t slots = 1;
+    while (slots < (uint64_t)options->frontier * explorer.input_count * options->depth * 2)
+    {
+        slots <<= 1;
+    }
+    explorer.visited.slots = calloc(slots, sizeof(uint64_t));
+    explorer.visited.mask = slots - 1;
+
+    struct Chip8 *current = malloc(options->frontier * sizeof(struct Chip8));
+    struct Chip8 *next = malloc(options->frontier * sizeof(struct Chip8));
+    struct Worker *workers = calloc(options->threads, sizeof(struct Worker));
+    if (explorer.visited.slots == NULL || current == NULL || next == NULL || workers == NULL)
+    {
+        printf("%s\n", chip8_error_string(CHIP8_ERR_NO_MEMORY));
+        exit(-1);
+    }
+
+    chip8_copy_state(&current[0], root);
+    explorer.frontier = current;
+    explorer.frontier_count = 1;
+    visited_insert(&explorer.visited, hash_state(root));
+
+    explorer.next_capacity = options->frontier;
+    for (unsigned int t = 0; t < options->threads; t++)
+    {
+        workers[t].explorer = &explorer;
+        chip8_init(&workers[t].work);
+    }
+
+    uint64_t total_frames = 0, total_novel = 0, total_dropped = 0, total_unrecorded = 0;
+    double start = now();
+
+    for (unsigned int depth = 1; depth <= options->depth && explorer.frontier_count > 0; depth++)
+    {
+        double level_start = now();
+        explorer.cursor = 0;
+        explorer.next = next;
+        explorer.next_count = 0;
+
+        for (unsigned int t = 0; t < options->threads; t++)
+        {
+            workers[t].frames = 0;
+            workers[t].novel = 0;
+            workers[t].dropped = 0;
+            workers[t].unrecorded = 0;
+            pthread_create(&workers[t].thread, NULL, worker_run, &workers[t]);
+        }
+
+        uint64_t frames = 0, novel = 0, unrecorded = 0;
+        for (unsigned int t = 0; t < options->threads; t++)
+        {
+            pthread_join(workers[t].thread, NULL);
+            frames += workers[t].frames;
+            novel += workers[t].novel;
+            unrecorded += workers[t].unrecorded;
+            total_dropped += workers[t].dropped;
+        }
+        total_frames += frames;
+        total_novel += novel;
+        total_unrecorded += unrecorded;
+
+        // claims past the end were counted as dropped
+        size_t next_count = explorer.next_count < explorer.next_capacity ? explorer.next_count : explorer.next_capacity;
+
+        unsigned int covered = 0;
+        for (unsigned int pc = 0; pc < 4096; pc++)
+        {
+            uint8_t hit = 0;
+            for (unsigned int t = 0; t < options->threads; t++)
+            {
+                hit |= workers[t].coverage[pc];
+            }
+            covered += hit;
+        }
+
+        double elapsed = now() - level_start;
+        printf("depth %2u: expanded %8zu  frames %10llu  novel %9llu  %12.0f frames/s  %11.0f novel/s  pcs %u\n",
+               depth, explorer.frontier_count, (unsigned long long)frames, (unsigned long long)novel,
+               frames / elapsed, novel / elapsed, covered);
+        if (unrecorded > 0)
+            printf("depth %2u: visited set full, %llu states expanded without deduplication\n", depth,
+                   (unsigned long long)unrecorded);
+
+        struct Chip8 *swap = current;
+        current = next;
+        next = swap;
+        explorer.frontier = current;
+        explorer.frontier_count = next_count;
+    }
+
+    double elapsed = now() - start;
+    printf("total: frames %llu  novel states %llu  not expanded %llu  %.2fs  %.0f frames/s  %.0f novel/s\n",
+           (unsigned long long)total_frames, (unsigned long long)total_novel, (unsigned long long)total_dropped,
+           elapsed, total_frames / elapsed, total_novel / elapsed);
+    if (total_unrecorded > 0)
+        printf("visited set full: %llu states were not recorded, novel counts include duplicates\n",
+               (unsigned long long)total_unrecorded);
+
+    if (options->coverage_filename)
+    {
+        FILE *out = fopen(options->coverage_filename, "w");
+        if (out == NULL)
+        {
+            printf("%s: %s\n", options->coverage_filename, chip8_error_string(CHIP8_ERR_FILE));
+            exit(-1);
+        }
+        for (unsigned int pc = 0; pc < 4096; pc++)
+        {
+            for (unsigned int t = 0; t < options->threads; t++)
+            {
+                if (workers[t].coverage[pc])
+                {
+                    fprintf(out, "%03X\n", pc);
+                    break;
+                }
+            }
+        }
+        fclose(out);
+    }
+
+    free(workers);
+    free(next);
+    free(current);
+    free(explorer.visited.slots);
+    free(root);
+    return 0;
+}
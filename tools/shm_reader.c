@@ -0,0 +1,115 @@
+// shm_reader: reference reader for the segment published by `main ... --shm NAME`
+//
+// usage: shm_reader NAME [--frames N] [--quiet]
+//
+// polls the segment, takes a consistent copy through the seqlock and draws new frames on the terminal.
+// --quiet only counts frames, --frames stops after N new frames
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shm_export.h"
+
+static void draw(struct Chip8SharedFrame const *frame)
+{
+    // home the cursor instead of clearing to avoid flicker
+    printf("\033[H");
+    for (uint32_t y = 0; y < frame->height; y += 2)
+    {
+        for (uint32_t x = 0; x < frame->width; x++)
+        {
+            int top = frame->video[y * frame->width + x] != 0;
+            int bottom = y + 1 < frame->height && frame->video[(y + 1) * frame->width + x] != 0;
+            // two pixel rows per line
+            fputs(top && bottom ? "█" : top ? "▀" : bottom ? "▄" : " ", stdout);
+        }
+        printf("\n");
+    }
+    printf("frame %llu  pc %03X  I %03X  sp %X  dt %02X  st %02X\n", (unsigned long long)frame->frame, frame->pc,
+           frame->index, frame->sp, frame->delay_timer, frame->sound_timer);
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        printf("V%X=%02X ", i, frame->registers[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("args required: name [--frames N] [--quiet]\n");
+        exit(-1);
+    }
+
+    unsigned long max_frames = 0;
+    char quiet = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            max_frames = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--quiet") == 0)
+            quiet = 1;
+    }
+
+    int fd = shm_open(argv[1], O_RDONLY, 0);
+    if (fd < 0)
+    {
+        printf("%s: no such segment, is the emulator running with --shm?\n", argv[1]);
+        exit(-1);
+    }
+
+    struct Chip8SharedFrame const *shared =
+        mmap(NULL, sizeof(struct Chip8SharedFrame), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shared == MAP_FAILED)
+    {
+        printf("%s: couldnt map segment\n", argv[1]);
+        exit(-1);
+    }
+
+    while (__atomic_load_n(&shared->magic, __ATOMIC_ACQUIRE) != CHIP8_SHM_MAGIC)
+    {
+        usleep(1000);
+    }
+    if (shared->version != CHIP8_SHM_VERSION)
+    {
+        printf("%s: version %u, expected %u\n", argv[1], shared->version, CHIP8_SHM_VERSION);
+        exit(-1);
+    }
+
+    struct Chip8SharedFrame frame;
+    uint64_t last_frame = 0;
+    unsigned long seen = 0;
+
+    if (!quiet)
+        printf("\033[2J");
+
+    while (max_frames == 0 || seen < max_frames)
+    {
+        shm_export_read(shared, &frame);
+
+        if (frame.frame != last_frame)
+        {
+            last_frame = frame.frame;
+            seen++;
+            if (!quiet)
+                draw(&frame);
+        }
+
+        // a bit faster than 60 Hz
+        usleep(8000);
+    }
+
+    printf("read %lu frames, last published %llu\n", seen, (unsigned long long)last_frame);
+
+    munmap((void *)shared, sizeof(struct Chip8SharedFrame));
+    return 0;
+}